@@ -0,0 +1,180 @@
+#include "AssetCache.h"
+
+#include <stdexcept>
+#include "LZ77.h"
+#include "BigTilesCmp.h"
+
+AssetCache::AssetCache(size_t budget)
+	: m_epoch(0), m_cache(budget), m_hits(0), m_misses(0)
+{
+}
+
+void AssetCache::Init(const std::shared_ptr<const Rom>& rom)
+{
+	std::lock_guard<std::mutex> lock(m_rom_mutex);
+	m_rom = rom;
+	m_epoch++;
+	m_cache.Clear();
+	m_hits = 0;
+	m_misses = 0;
+}
+
+void AssetCache::Clear()
+{
+	Init(nullptr);
+}
+
+std::shared_ptr<const Tileset> AssetCache::GetTileset(uint32_t offset) const
+{
+	const Key key = { ASSET_TILESET, offset, 0 };
+	return std::static_pointer_cast<const Tileset>(Get(key, [offset](const Rom& rom, size_t& cost)
+	{
+		auto tileset = DecodeTileset(rom, offset);
+		cost = GetCost(*tileset);
+		return tileset;
+	}));
+}
+
+std::shared_ptr<const std::vector<BigTile>> AssetCache::GetBlockset(uint32_t primary, uint32_t secondary) const
+{
+	const Key key = { ASSET_BLOCKSET, primary, secondary };
+	return std::static_pointer_cast<const std::vector<BigTile>>(Get(key, [primary, secondary](const Rom& rom, size_t& cost)
+	{
+		auto blockset = DecodeBlockset(rom, primary, secondary);
+		cost = GetCost(*blockset);
+		return blockset;
+	}));
+}
+
+std::shared_ptr<const RoomTilemap> AssetCache::GetRoomMap(uint32_t offset) const
+{
+	const Key key = { ASSET_ROOM_MAP, offset, 0 };
+	return std::static_pointer_cast<const RoomTilemap>(Get(key, [offset](const Rom& rom, size_t& cost)
+	{
+		auto map = DecodeRoomMap(rom, offset);
+		cost = GetCost(*map);
+		return map;
+	}));
+}
+
+bool AssetCache::ContainsTileset(uint32_t offset) const
+{
+	const Key key = { ASSET_TILESET, offset, 0 };
+	return m_cache.Contains(key);
+}
+
+bool AssetCache::ContainsBlockset(uint32_t primary, uint32_t secondary) const
+{
+	const Key key = { ASSET_BLOCKSET, primary, secondary };
+	return m_cache.Contains(key);
+}
+
+bool AssetCache::ContainsRoomMap(uint32_t offset) const
+{
+	const Key key = { ASSET_ROOM_MAP, offset, 0 };
+	return m_cache.Contains(key);
+}
+
+void AssetCache::SetBudget(size_t budget)
+{
+	m_cache.SetBudget(budget);
+}
+
+size_t AssetCache::GetBudget() const
+{
+	return m_cache.GetBudget();
+}
+
+size_t AssetCache::GetUsage() const
+{
+	return m_cache.GetUsage();
+}
+
+AssetCache::Stats AssetCache::GetStats() const
+{
+	Stats stats;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	return stats;
+}
+
+std::shared_ptr<const Tileset> AssetCache::DecodeTileset(const Rom& rom, uint32_t offset)
+{
+	std::vector<uint8_t> buffer(65536);
+	size_t elen = 0;
+	LZ77::Decode(rom.data(offset), buffer.size(), buffer.data(), elen);
+	auto tileset = std::make_shared<Tileset>();
+	tileset->setBits(buffer.data(), 0x400);
+	return tileset;
+}
+
+// A blockset is a primary part followed by an optional secondary part. A
+// secondary offset of zero means the primary part alone.
+std::shared_ptr<const std::vector<BigTile>> AssetCache::DecodeBlockset(const Rom& rom, uint32_t primary, uint32_t secondary)
+{
+	auto blockset = std::make_shared<std::vector<BigTile>>();
+	BigTilesCmp::Decode(rom.data(primary), *blockset);
+	if (secondary != 0)
+	{
+		BigTilesCmp::Decode(rom.data(secondary), *blockset);
+	}
+	return blockset;
+}
+
+std::shared_ptr<const RoomTilemap> AssetCache::DecodeRoomMap(const Rom& rom, uint32_t offset)
+{
+	auto map = std::make_shared<RoomTilemap>();
+	LSTilemapCmp::Decode(rom.data(offset), *map);
+	return map;
+}
+
+size_t AssetCache::GetCost(const Tileset& tileset)
+{
+	return sizeof(Tileset) + tileset.size() * 64;
+}
+
+size_t AssetCache::GetCost(const std::vector<BigTile>& blockset)
+{
+	return sizeof(blockset) + blockset.size() * sizeof(BigTile);
+}
+
+size_t AssetCache::GetCost(const RoomTilemap& map)
+{
+	return sizeof(RoomTilemap)
+		+ (map.foreground.GetWidth() * map.foreground.GetHeight()
+		+ map.background.GetWidth() * map.background.GetHeight()) * sizeof(uint16_t)
+		+ map.heightmap.size() * sizeof(HeightMapCell);
+}
+
+std::shared_ptr<const void> AssetCache::Get(const Key& key, const Decoder& decode) const
+{
+	auto value = m_cache.Find(key);
+	if (value != nullptr)
+	{
+		m_hits++;
+		return value;
+	}
+	m_misses++;
+
+	std::shared_ptr<const Rom> rom;
+	unsigned epoch;
+	{
+		std::lock_guard<std::mutex> lock(m_rom_mutex);
+		rom = m_rom;
+		epoch = m_epoch;
+	}
+	if (rom == nullptr)
+	{
+		throw std::runtime_error("Attempt to decode an asset with no ROM loaded");
+	}
+	// Decoding happens outside the lock. Two threads missing on the same key
+	// will both decode it, and the second insert simply replaces the first.
+	size_t cost = 0;
+	value = decode(*rom, cost);
+	std::lock_guard<std::mutex> lock(m_rom_mutex);
+	if (epoch == m_epoch)
+	{
+		m_cache.Insert(key, value, cost);
+	}
+	return value;
+}
@@ -0,0 +1,89 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Rom.h"
+#include "Tileset.h"
+#include "BigTile.h"
+#include "LSTilemapCmp.h"
+#include "LruCache.h"
+
+// Decoded tilesets, blocksets and room maps, keyed by their ROM offsets. All
+// three kinds share one budget: each entry is charged its approximate size
+// in bytes, and the least recently used entries are dropped once the budget
+// is exceeded. Safe to use from several threads at once.
+class AssetCache
+{
+public:
+	static const size_t DEFAULT_BUDGET = 32 * 1024 * 1024;
+
+	struct Stats
+	{
+		size_t hits;
+		size_t misses;
+	};
+
+	explicit AssetCache(size_t budget = DEFAULT_BUDGET);
+
+	void Init(const std::shared_ptr<const Rom>& rom);
+	void Clear();
+	std::shared_ptr<const Tileset> GetTileset(uint32_t offset) const;
+	std::shared_ptr<const std::vector<BigTile>> GetBlockset(uint32_t primary, uint32_t secondary) const;
+	std::shared_ptr<const RoomTilemap> GetRoomMap(uint32_t offset) const;
+	bool ContainsTileset(uint32_t offset) const;
+	bool ContainsBlockset(uint32_t primary, uint32_t secondary) const;
+	bool ContainsRoomMap(uint32_t offset) const;
+	void SetBudget(size_t budget);
+	size_t GetBudget() const;
+	size_t GetUsage() const;
+	Stats GetStats() const;
+
+	static std::shared_ptr<const Tileset> DecodeTileset(const Rom& rom, uint32_t offset);
+	static std::shared_ptr<const std::vector<BigTile>> DecodeBlockset(const Rom& rom, uint32_t primary, uint32_t secondary);
+	static std::shared_ptr<const RoomTilemap> DecodeRoomMap(const Rom& rom, uint32_t offset);
+	static size_t GetCost(const Tileset& tileset);
+	static size_t GetCost(const std::vector<BigTile>& blockset);
+	static size_t GetCost(const RoomTilemap& map);
+private:
+	enum AssetType
+	{
+		ASSET_TILESET,
+		ASSET_BLOCKSET,
+		ASSET_ROOM_MAP
+	};
+
+	struct Key
+	{
+		AssetType type;
+		uint32_t offset;
+		uint32_t secondary;
+
+		bool operator<(const Key& rhs) const
+		{
+			if (type != rhs.type) return type < rhs.type;
+			if (offset != rhs.offset) return offset < rhs.offset;
+			return secondary < rhs.secondary;
+		}
+	};
+
+	typedef std::function<std::shared_ptr<const void>(const Rom&, size_t&)> Decoder;
+
+	std::shared_ptr<const void> Get(const Key& key, const Decoder& decode) const;
+
+	// The ROM is shared with any worker still decoding from it, so opening
+	// another ROM can't pull it out from under them. The epoch changes with
+	// the ROM, and stops those workers caching what they decoded from it.
+	std::shared_ptr<const Rom> m_rom;
+	unsigned m_epoch;
+	mutable std::mutex m_rom_mutex;
+	mutable LruCache<Key, void> m_cache;
+	mutable std::atomic<size_t> m_hits;
+	mutable std::atomic<size_t> m_misses;
+};
+
+#endif // ASSET_CACHE_H
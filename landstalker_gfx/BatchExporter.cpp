@@ -0,0 +1,663 @@
+#include "BatchExporter.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include "Tilemap2D.h"
+#include "Blockmap2D.h"
+#include "RoomRenderCache.h"
+#include "HeightmapOverlay.h"
+#include "HeightmapView.h"
+#include "SpriteFrame.h"
+#include "ContentHash.h"
+#include "LZ77.h"
+#include "BigTilesCmp.h"
+#include "LSTilemapCmp.h"
+
+namespace
+{
+std::string MakeFilename(const char* prefix, size_t index, int width)
+{
+	std::ostringstream ss;
+	ss << prefix << "_" << std::dec << std::setw(width) << std::setfill('0') << index << ".png";
+	return ss.str();
+}
+
+std::string GetOutputPath(const BatchExporter::Job& job, const BatchExporter::Options& options)
+{
+	return options.output_dir + "/" + job.filename;
+}
+}
+
+BatchExporter::Options::Options()
+	: output_dir("."),
+	  assets(ASSET_ALL),
+	  room_layers(ROOM_BACKGROUND | ROOM_FOREGROUND),
+	  heightmap_opacity(0x80)
+{
+}
+
+BatchExporter::BatchExporter(const std::shared_ptr<const Rom>& rom, const RomTables& tables)
+	: m_rom(rom), m_tables(tables)
+{
+	m_assets.Init(m_rom);
+	m_spriteFrames.Init(*m_rom, m_tables.spriteFrameOffsets);
+	m_framePalettes.resize(m_tables.spriteFrameOffsets.size());
+	std::vector<bool> resolved(m_framePalettes.size(), false);
+	for (uint8_t sprite_id : m_tables.spriteIds)
+	{
+		const Sprite& sprite = m_tables.sprites[sprite_id];
+		if (sprite.GetGraphicsIdx() >= m_tables.spriteGraphics.size())
+		{
+			continue;
+		}
+		const SpriteGraphic& sg = m_tables.spriteGraphics[sprite.GetGraphicsIdx()];
+		const Palette& pal = sprite.GetPalette(m_rom->data(RomTables::SPRITE_HIGH_PALETTES), m_rom->data(RomTables::SPRITE_LOW_PALETTES));
+		for (size_t a = 0; a < sg.GetAnimationCount(); ++a)
+		{
+			for (size_t f = 0; f < sg.GetFrameCount(a); ++f)
+			{
+				const size_t frame = sg.RetrieveFrameIdx(a, f);
+				if ((frame < resolved.size()) && !resolved[frame])
+				{
+					m_framePalettes[frame] = pal;
+					resolved[frame] = true;
+				}
+			}
+		}
+	}
+}
+
+std::vector<BatchExporter::Job> BatchExporter::GetJobs(const Options& options) const
+{
+	std::vector<Job> jobs;
+	if (options.assets & ASSET_TILESETS)
+	{
+		for (size_t i = 0; i < m_tables.tilesetOffsets.size(); ++i)
+		{
+			jobs.push_back(Job{ ASSET_TILESETS, i, 0, MakeFilename("tileset", i, 2) });
+		}
+	}
+	if (options.assets & ASSET_BLOCKSETS)
+	{
+		for (size_t i = 0; i < m_tables.bigTileOffsets.size(); ++i)
+		{
+			// Blocksets are drawn with the tileset of the same number, as
+			// in the browser; some have no such tileset
+			if ((i & 0x1F) >= m_tables.tilesetOffsets.size())
+			{
+				continue;
+			}
+			for (size_t j = 0; j < m_tables.bigTileOffsets[i].size(); ++j)
+			{
+				std::ostringstream ss;
+				ss << "blockset_" << std::setw(2) << std::setfill('0') << i << "_" << j << ".png";
+				jobs.push_back(Job{ ASSET_BLOCKSETS, i, j, ss.str() });
+			}
+		}
+	}
+	if (options.assets & ASSET_ROOMS)
+	{
+		for (size_t i = 0; i < m_tables.rooms.size(); ++i)
+		{
+			jobs.push_back(Job{ ASSET_ROOMS, i, 0, MakeFilename("room", i, 3) });
+		}
+	}
+	if (options.assets & ASSET_HEIGHTMAPS)
+	{
+		for (size_t i = 0; i < m_tables.rooms.size(); ++i)
+		{
+			jobs.push_back(Job{ ASSET_HEIGHTMAPS, i, 0, MakeFilename("heightmap", i, 3) });
+		}
+	}
+	if (options.assets & ASSET_SPRITE_FRAMES)
+	{
+		for (size_t i = 0; i < m_tables.spriteFrameOffsets.size(); ++i)
+		{
+			jobs.push_back(Job{ ASSET_SPRITE_FRAMES, i, 0, MakeFilename("sprite_frame", i, 4) });
+		}
+	}
+	return jobs;
+}
+
+// Renders and writes a single image, returning the number of pixels written.
+// Images with nothing in them are not written, and count as zero pixels.
+size_t BatchExporter::ExportJob(const Job& job, const Options& options) const
+{
+	return ExportJob(job, options, SpriteFrames());
+}
+
+// As above, with sprite frames taken from those already decoded where there
+// is one; any other frame is decoded here
+size_t BatchExporter::ExportJob(const Job& job, const Options& options, const SpriteFrames& frames) const
+{
+	const std::string path = GetOutputPath(job, options);
+	switch (job.asset)
+	{
+	case ASSET_TILESETS:
+		return ExportTileset(job, path);
+	case ASSET_BLOCKSETS:
+		return ExportBlockset(job, path);
+	case ASSET_ROOMS:
+		return ExportRoom(job, options, path);
+	case ASSET_HEIGHTMAPS:
+		return ExportHeightmap(job, path);
+	case ASSET_SPRITE_FRAMES:
+		if ((job.index < frames.size()) && (frames[job.index] != nullptr))
+		{
+			return ExportSpriteFrame(job, *frames[job.index], path);
+		}
+		return ExportSpriteFrame(job, SpriteFrame(m_rom->data(m_tables.spriteFrameOffsets[job.index])), path);
+	default:
+		throw std::runtime_error("Unknown asset type in export job " + job.filename);
+	}
+}
+
+BatchExporter::Summary BatchExporter::Export(const Options& options, ThreadPool& pool, ExportManifest* manifest) const
+{
+	const std::vector<Job> jobs = GetJobs(options);
+	Summary summary{ pool.GetWorkerCount(), jobs.size(), 0, 0, 0, 0, 0.0, {}, {}, {} };
+	std::mutex mutex;
+
+	auto start = std::chrono::steady_clock::now();
+	SourceSizes sizes;
+	SpriteFrames frames;
+	if (options.assets & ASSET_SPRITE_FRAMES)
+	{
+		frames = DecodeSpriteFrames(pool, summary.sprite_decode, sizes);
+	}
+	// Finding where each compressed asset ends means decoding it, so each
+	// one is measured once rather than for every image that uses it
+	if (manifest != nullptr)
+	{
+		MeasureSources(jobs, pool, sizes);
+	}
+	std::vector<uint64_t> hashes(jobs.size(), 0);
+	std::vector<size_t> written(jobs.size(), 0);
+	std::vector<char> exported(jobs.size(), 0);
+	std::vector<char> failed(jobs.size(), 0);
+	pool.ParallelFor(jobs.size(), [&](size_t i)
+	{
+		const Job& job = jobs[i];
+		auto job_start = std::chrono::steady_clock::now();
+		if (manifest != nullptr)
+		{
+			hashes[i] = GetInputHash(job, options, sizes);
+			if (manifest->IsCurrent(job.filename, hashes[i], GetOutputPath(job, options)))
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				summary.unchanged++;
+				return;
+			}
+		}
+		size_t pixels = 0;
+		std::string error;
+		try
+		{
+			pixels = ExportJob(job, options, frames);
+			if (pixels == 0)
+			{
+				// Nothing is written for an empty image, so a file left from
+				// an earlier export would otherwise linger out of date
+				std::remove(GetOutputPath(job, options).c_str());
+			}
+			written[i] = pixels;
+			exported[i] = 1;
+		}
+		catch (const std::exception& e)
+		{
+			error = job.filename + ": " + e.what();
+			failed[i] = 1;
+		}
+		auto job_end = std::chrono::steady_clock::now();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!error.empty())
+		{
+			summary.errors.push_back(error);
+			return;
+		}
+		AssetTotals& totals = summary.totals[job.asset];
+		totals.render_seconds += std::chrono::duration<double>(job_end - job_start).count();
+		if (pixels == 0)
+		{
+			summary.skipped++;
+			return;
+		}
+		totals.images++;
+		totals.pixels += pixels;
+		summary.images++;
+		summary.pixels += pixels;
+	});
+	auto end = std::chrono::steady_clock::now();
+	summary.seconds = std::chrono::duration<double>(end - start).count();
+	std::sort(summary.errors.begin(), summary.errors.end());
+
+	// Images that failed are dropped from the manifest, so the next run
+	// tries them again
+	if (manifest != nullptr)
+	{
+		for (size_t i = 0; i < jobs.size(); ++i)
+		{
+			if (exported[i])
+			{
+				manifest->Set(jobs[i].filename, hashes[i], written[i]);
+			}
+			else if (failed[i])
+			{
+				manifest->Erase(jobs[i].filename);
+			}
+		}
+	}
+	return summary;
+}
+
+// Everything an image is drawn from: the compressed data, the palettes and
+// the options that affect it
+uint64_t BatchExporter::GetInputHash(const Job& job, const Options& options, const SourceSizes& sizes) const
+{
+	ContentHash hash;
+	hash.Add(RENDER_VERSION);
+	hash.Add(job.asset);
+	hash.Add(job.index);
+	hash.Add(job.part);
+	for (const auto& source : GetSources(job))
+	{
+		auto size = sizes.find(source);
+		const size_t length = (size != sizes.end()) ? size->second : 0;
+		hash.Add(source.first);
+		hash.Add(length);
+		hash.Add(m_rom->data(source.second), length);
+	}
+	for (const auto& pal : GetPalettes(job))
+	{
+		for (uint32_t rgba : pal.getRGBALut())
+		{
+			hash.Add(rgba);
+		}
+	}
+	if (job.asset == ASSET_ROOMS)
+	{
+		hash.Add(options.room_layers);
+		if (options.room_layers & ROOM_HEIGHTMAP)
+		{
+			hash.Add(options.heightmap_opacity);
+		}
+	}
+	return hash.GetValue();
+}
+
+std::vector<BatchExporter::Source> BatchExporter::GetSources(const Job& job) const
+{
+	std::vector<Source> sources;
+	auto add_blockset = [&](size_t blockset, size_t part)
+	{
+		const std::vector<uint32_t>& offsets = m_tables.bigTileOffsets[blockset];
+		if (!offsets.empty())
+		{
+			sources.push_back(Source(SOURCE_BLOCKSET, offsets[0]));
+			if ((part > 0) && (part < offsets.size()))
+			{
+				sources.push_back(Source(SOURCE_BLOCKSET, offsets[part]));
+			}
+		}
+	};
+	switch (job.asset)
+	{
+	case ASSET_TILESETS:
+		sources.push_back(Source(SOURCE_TILESET, m_tables.tilesetOffsets[job.index]));
+		break;
+	case ASSET_BLOCKSETS:
+		sources.push_back(Source(SOURCE_TILESET, m_tables.tilesetOffsets[job.index & 0x1F]));
+		add_blockset(job.index, job.part);
+		break;
+	case ASSET_ROOMS:
+	{
+		const RomTables::RoomData& rd = m_tables.rooms[job.index];
+		sources.push_back(Source(SOURCE_ROOM_MAP, rd.offset));
+		sources.push_back(Source(SOURCE_TILESET, m_tables.tilesetOffsets[rd.tileset]));
+		add_blockset(rd.bigTilesetIdx, 1 + rd.secBigTileset);
+		break;
+	}
+	case ASSET_HEIGHTMAPS:
+		sources.push_back(Source(SOURCE_ROOM_MAP, m_tables.rooms[job.index].offset));
+		break;
+	case ASSET_SPRITE_FRAMES:
+		sources.push_back(Source(SOURCE_SPRITE_FRAME, m_tables.spriteFrameOffsets[job.index]));
+		break;
+	default:
+		break;
+	}
+	return sources;
+}
+
+// Decodes the whole sprite frame table at once. The frames that decode also
+// give their compressed sizes, so the manifest needn't measure them again;
+// frames that fail are left out, and fail again when their image is drawn.
+BatchExporter::SpriteFrames BatchExporter::DecodeSpriteFrames(ThreadPool& pool, SpriteDecodeTotals& totals, SourceSizes& sizes) const
+{
+	std::vector<SpriteFrameStore::DecodeStats> stats;
+	auto start = std::chrono::steady_clock::now();
+	SpriteFrames frames = m_spriteFrames.DecodeAll(pool, &stats);
+	auto end = std::chrono::steady_clock::now();
+
+	totals = SpriteDecodeTotals{ frames.size(), 0, 0, 0, 0.0, 0.0, 0, 0.0 };
+	totals.seconds = std::chrono::duration<double>(end - start).count();
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		if (frames[i] == nullptr)
+		{
+			totals.failed++;
+			continue;
+		}
+		totals.compressed_bytes += stats[i].compressed_size;
+		totals.uncompressed_bytes += stats[i].uncompressed_size;
+		totals.worker_seconds += stats[i].decode_time_us / 1.0e6;
+		if (stats[i].decode_time_us > totals.slowest_us)
+		{
+			totals.slowest_us = stats[i].decode_time_us;
+			totals.slowest_offset = stats[i].offset;
+		}
+		sizes[Source(SOURCE_SPRITE_FRAME, stats[i].offset)] = stats[i].compressed_size;
+	}
+	return frames;
+}
+
+// Adds the size of every source the jobs use that isn't already known
+void BatchExporter::MeasureSources(const std::vector<Job>& jobs, ThreadPool& pool, SourceSizes& sizes) const
+{
+	std::set<Source> unique;
+	for (const auto& job : jobs)
+	{
+		for (const auto& source : GetSources(job))
+		{
+			if (sizes.find(source) == sizes.end())
+			{
+				unique.insert(source);
+			}
+		}
+	}
+	const std::vector<Source> sources(unique.begin(), unique.end());
+	std::vector<size_t> lengths(sources.size(), 0);
+	pool.ParallelFor(sources.size(), [&](size_t i)
+	{
+		// Data that fails to decode is left at zero length; the images drawn
+		// from it fail in turn and are reported then
+		try
+		{
+			lengths[i] = MeasureSource(*m_rom, sources[i]);
+		}
+		catch (const std::exception&)
+		{
+		}
+	});
+	for (size_t i = 0; i < sources.size(); ++i)
+	{
+		sizes[sources[i]] = lengths[i];
+	}
+}
+
+size_t BatchExporter::MeasureSource(const Rom& rom, const Source& source)
+{
+	size_t length = 0;
+	switch (source.first)
+	{
+	case SOURCE_TILESET:
+	{
+		std::vector<uint8_t> buffer(65536);
+		LZ77::Decode(rom.data(source.second), buffer.size(), buffer.data(), length);
+		break;
+	}
+	case SOURCE_BLOCKSET:
+	{
+		std::vector<BigTile> blockset;
+		BigTilesCmp::Decode(rom.data(source.second), blockset, length);
+		break;
+	}
+	case SOURCE_ROOM_MAP:
+	{
+		RoomTilemap map;
+		LSTilemapCmp::Decode(rom.data(source.second), map, length);
+		break;
+	}
+	case SOURCE_SPRITE_FRAME:
+		length = SpriteFrame(rom.data(source.second)).GetCompressedSize();
+		break;
+	}
+	return length;
+}
+
+const char* BatchExporter::GetAssetName(Asset asset)
+{
+	switch (asset)
+	{
+	case ASSET_TILESETS:
+		return "Tilesets";
+	case ASSET_BLOCKSETS:
+		return "Blocksets";
+	case ASSET_ROOMS:
+		return "Rooms";
+	case ASSET_HEIGHTMAPS:
+		return "Heightmaps";
+	case ASSET_SPRITE_FRAMES:
+		return "Sprite frames";
+	default:
+		return "Unknown";
+	}
+}
+
+size_t BatchExporter::ExportTileset(const Job& job, const std::string& path) const
+{
+	auto tileset = m_assets.GetTileset(m_tables.tilesetOffsets[job.index]);
+	const size_t row_width = std::min<size_t>(16U, tileset->size());
+	const size_t row_height = std::min<size_t>(128U, tileset->size() / row_width + (tileset->size() % row_width != 0));
+	Tilemap2D map(row_width, row_height, 0, 0, 0);
+	ImageBuffer buffer(map.GetBitmapWidth(), map.GetBitmapHeight());
+	map.SetTileset(tileset);
+	map.Fill(0, 1);
+	map.Draw(buffer);
+	return WritePNG(buffer, GetPalettes(job), path);
+}
+
+size_t BatchExporter::ExportBlockset(const Job& job, const std::string& path) const
+{
+	auto blockset = GetBlockset(job.index, job.part);
+	if (blockset->empty())
+	{
+		return 0;
+	}
+	const size_t row_width = std::min<size_t>(16U, blockset->size());
+	const size_t row_height = std::min<size_t>(128U, blockset->size() / row_width + (blockset->size() % row_width != 0));
+	Blockmap2D map(row_width, row_height, 0, 0, 0);
+	ImageBuffer buffer(map.GetBitmapWidth(), map.GetBitmapHeight());
+	map.SetTileset(m_assets.GetTileset(m_tables.tilesetOffsets[job.index & 0x1F]));
+	map.SetBlockset(blockset);
+	map.Fill(0, 1);
+	map.Draw(buffer);
+	return WritePNG(buffer, GetPalettes(job), path);
+}
+
+size_t BatchExporter::ExportRoom(const Job& job, const Options& options, const std::string& path) const
+{
+	const RomTables::RoomData& rd = m_tables.rooms[job.index];
+	auto map = GetRoomMap(job.index);
+	const size_t width = map->background.GetBitmapWidth();
+	const size_t height = map->background.GetBitmapHeight();
+	if ((width == 0) || (height == 0))
+	{
+		return 0;
+	}
+	auto tileset = m_assets.GetTileset(m_tables.tilesetOffsets[rd.tileset]);
+	auto blockset = GetBlockset(rd.bigTilesetIdx, 1 + rd.secBigTileset);
+	map->background.SetTileset(tileset);
+	map->foreground.SetTileset(tileset);
+	map->background.SetBlockset(blockset);
+	map->foreground.SetBlockset(blockset);
+	const std::vector<Palette> pals = GetPalettes(job);
+
+	if ((options.room_layers & ROOM_HEIGHTMAP) == 0)
+	{
+		// Without the heightmap the layers stay paletted: the foreground is
+		// simply drawn over the background
+		ImageBuffer buffer(width, height);
+		if (options.room_layers & ROOM_BACKGROUND)
+		{
+			map->background.Draw(buffer);
+		}
+		if (options.room_layers & ROOM_FOREGROUND)
+		{
+			map->foreground.Draw(buffer);
+		}
+		return WritePNG(buffer, pals, path);
+	}
+
+	RoomRenderCache layers;
+	std::array<RoomRenderCache::LayerOpacity, RoomRenderCache::LAYER_COUNT> opacity;
+	layers.Begin(static_cast<uint16_t>(job.index), rd.roomPalette, width, height);
+	ImageBuffer buffer(width, height);
+	if (options.room_layers & ROOM_BACKGROUND)
+	{
+		map->background.Draw(buffer);
+		layers.SetLayer(RoomRenderCache::LAYER_BACKGROUND, buffer, pals);
+	}
+	if (options.room_layers & ROOM_FOREGROUND)
+	{
+		buffer.Clear();
+		map->foreground.Draw(buffer);
+		layers.SetLayer(RoomRenderCache::LAYER_FOREGROUND, buffer, pals);
+	}
+	std::vector<uint8_t> hm_rgba;
+	HeightmapOverlay overlay;
+	overlay.Draw(*map, hm_rgba);
+	layers.SetLayer(RoomRenderCache::LAYER_HEIGHTMAP, hm_rgba);
+	opacity[RoomRenderCache::LAYER_BACKGROUND] = RoomRenderCache::LayerOpacity{ 0xFF, 0xFF };
+	opacity[RoomRenderCache::LAYER_FOREGROUND] = RoomRenderCache::LayerOpacity{ 0xFF, 0xFF };
+	opacity[RoomRenderCache::LAYER_HEIGHTMAP] = RoomRenderCache::LayerOpacity{ options.heightmap_opacity, options.heightmap_opacity };
+	if (!ImageBuffer::WritePNG(path, layers.Composite(opacity), width, height))
+	{
+		throw std::runtime_error("Unable to write " + path);
+	}
+	return width * height;
+}
+
+size_t BatchExporter::ExportHeightmap(const Job& job, const std::string& path) const
+{
+	auto map = GetRoomMap(job.index);
+	if (map->heightmap.empty())
+	{
+		return 0;
+	}
+	HeightmapView view;
+	ImageBuffer buffer;
+	view.Draw(*map, buffer);
+	return WritePNG(buffer, view.GetPalettes(), path);
+}
+
+size_t BatchExporter::ExportSpriteFrame(const Job& job, const SpriteFrame& frame, const std::string& path) const
+{
+	const SpriteFrame::Bounds bounds = frame.GetBounds();
+	if ((bounds.width == 0) || (bounds.height == 0))
+	{
+		return 0;
+	}
+	// Sprites are drawn with palette 1, as in the browser
+	ImageBuffer buffer(bounds.width, bounds.height);
+	buffer.InsertSprite(-bounds.left, -bounds.top, 1, frame);
+	return WritePNG(buffer, GetPalettes(job), path);
+}
+
+size_t BatchExporter::WritePNG(ImageBuffer& buffer, const std::vector<Palette>& pals, const std::string& path)
+{
+	if ((buffer.GetWidth() == 0) || (buffer.GetHeight() == 0))
+	{
+		return 0;
+	}
+	if (!buffer.WritePNG(path, pals))
+	{
+		throw std::runtime_error("Unable to write " + path);
+	}
+	return buffer.GetWidth() * buffer.GetHeight();
+}
+
+std::vector<Palette> BatchExporter::GetPalettes(const Job& job) const
+{
+	switch (job.asset)
+	{
+	case ASSET_TILESETS:
+		return GetRoomPalettes(FindTilesetPalette(job.index));
+	case ASSET_BLOCKSETS:
+		return GetRoomPalettes(FindBlocksetPalette(job.index, job.part));
+	case ASSET_ROOMS:
+		return GetRoomPalettes(m_tables.rooms[job.index].roomPalette);
+	case ASSET_HEIGHTMAPS:
+		return HeightmapView().GetPalettes();
+	case ASSET_SPRITE_FRAMES:
+	{
+		std::vector<Palette> pals(4);
+		pals[1] = m_framePalettes[job.index];
+		return pals;
+	}
+	default:
+		return std::vector<Palette>(4);
+	}
+}
+
+std::vector<Palette> BatchExporter::GetRoomPalettes(size_t room_palette) const
+{
+	std::vector<Palette> pals(4);
+	if (room_palette < m_tables.roomPalettes.size())
+	{
+		pals[0] = m_tables.roomPalettes[room_palette];
+	}
+	return pals;
+}
+
+// Tilesets and blocksets have no palette of their own, so they are drawn with
+// the palette of the first room that uses them
+size_t BatchExporter::FindTilesetPalette(size_t tileset) const
+{
+	for (const auto& rd : m_tables.rooms)
+	{
+		if (rd.tileset == tileset)
+		{
+			return rd.roomPalette;
+		}
+	}
+	return 0;
+}
+
+size_t BatchExporter::FindBlocksetPalette(size_t blockset, size_t part) const
+{
+	for (const auto& rd : m_tables.rooms)
+	{
+		if ((rd.bigTilesetIdx == blockset) && ((part == 0) || (part == 1U + rd.secBigTileset)))
+		{
+			return rd.roomPalette;
+		}
+	}
+	return FindTilesetPalette(blockset & 0x1F);
+}
+
+// Part zero is the primary part alone; any other part is drawn after it
+std::shared_ptr<const std::vector<BigTile>> BatchExporter::GetBlockset(size_t blockset, size_t part) const
+{
+	const std::vector<uint32_t>& offsets = m_tables.bigTileOffsets[blockset];
+	if (offsets.empty())
+	{
+		return std::make_shared<const std::vector<BigTile>>();
+	}
+	return m_assets.GetBlockset(offsets[0], ((part > 0) && (part < offsets.size())) ? offsets[part] : 0);
+}
+
+// The cached map is shared, and drawing attaches a tileset and blockset to
+// it, so each job works on its own copy
+std::shared_ptr<RoomTilemap> BatchExporter::GetRoomMap(size_t room) const
+{
+	return std::make_shared<RoomTilemap>(*m_assets.GetRoomMap(m_tables.rooms[room].offset));
+}
@@ -0,0 +1,159 @@
+#ifndef BATCH_EXPORTER_H
+#define BATCH_EXPORTER_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "AssetCache.h"
+#include "ExportManifest.h"
+#include "ImageBuffer.h"
+#include "Palette.h"
+#include "Rom.h"
+#include "RomTables.h"
+#include "SpriteFrame.h"
+#include "SpriteFrameStore.h"
+#include "ThreadPool.h"
+
+// Renders every tileset, blockset, room, heightmap and sprite frame of a ROM
+// to PNG files without any user interface. Each image is an independent job,
+// so the jobs are spread across a thread pool; the decoded tilesets and
+// blocksets the rooms share come from one asset cache. Sprite frames are all
+// decoded up front in one parallel pass, whose statistics are reported.
+//
+// Given a manifest, the export is incremental: each image's inputs are
+// hashed, and images whose hash matches the manifest, and whose file is
+// still there, are left alone.
+class BatchExporter
+{
+public:
+	// Part of every image's hash. Bump it whenever a change to the renderer
+	// alters the images, so that the next incremental export redraws them all.
+	static const uint32_t RENDER_VERSION = 1;
+
+	enum Asset : uint32_t
+	{
+		ASSET_TILESETS = 0x01,
+		ASSET_BLOCKSETS = 0x02,
+		ASSET_ROOMS = 0x04,
+		ASSET_HEIGHTMAPS = 0x08,
+		ASSET_SPRITE_FRAMES = 0x10,
+		ASSET_ALL = 0x1F
+	};
+
+	enum RoomLayer : uint32_t
+	{
+		ROOM_BACKGROUND = 0x01,
+		ROOM_FOREGROUND = 0x02,
+		ROOM_HEIGHTMAP = 0x04
+	};
+
+	struct Options
+	{
+		Options();
+
+		std::string output_dir;
+		uint32_t assets;
+		uint32_t room_layers;
+		// Only used when the heightmap is one of the room layers
+		uint8_t heightmap_opacity;
+	};
+
+	// One output image. Index is the tileset, blockset, room or sprite frame
+	// number; part is the blockset part, and zero otherwise. The filename is
+	// relative to the output directory.
+	struct Job
+	{
+		Asset asset;
+		size_t index;
+		size_t part;
+		std::string filename;
+	};
+
+	struct AssetTotals
+	{
+		size_t images;
+		size_t pixels;
+		double render_seconds;
+	};
+
+	struct SpriteDecodeTotals
+	{
+		size_t frames;
+		size_t failed;
+		size_t compressed_bytes;
+		size_t uncompressed_bytes;
+		double seconds;
+		double worker_seconds;
+		uint32_t slowest_offset;
+		double slowest_us;
+	};
+
+	struct Summary
+	{
+		size_t workers;
+		size_t jobs;
+		size_t images;
+		size_t skipped;
+		size_t unchanged;
+		size_t pixels;
+		double seconds;
+		std::map<Asset, AssetTotals> totals;
+		SpriteDecodeTotals sprite_decode;
+		std::vector<std::string> errors;
+	};
+
+	BatchExporter(const std::shared_ptr<const Rom>& rom, const RomTables& tables);
+
+	std::vector<Job> GetJobs(const Options& options) const;
+	size_t ExportJob(const Job& job, const Options& options) const;
+	Summary Export(const Options& options, ThreadPool& pool, ExportManifest* manifest = nullptr) const;
+
+	static const char* GetAssetName(Asset asset);
+private:
+	// Compressed data in the ROM that an image is drawn from
+	enum SourceType
+	{
+		SOURCE_TILESET,
+		SOURCE_BLOCKSET,
+		SOURCE_ROOM_MAP,
+		SOURCE_SPRITE_FRAME
+	};
+	typedef std::pair<SourceType, uint32_t> Source;
+	typedef std::map<Source, size_t> SourceSizes;
+	typedef std::vector<std::shared_ptr<const SpriteFrame>> SpriteFrames;
+
+	size_t ExportJob(const Job& job, const Options& options, const SpriteFrames& frames) const;
+	SpriteFrames DecodeSpriteFrames(ThreadPool& pool, SpriteDecodeTotals& totals, SourceSizes& sizes) const;
+	std::vector<Source> GetSources(const Job& job) const;
+	void MeasureSources(const std::vector<Job>& jobs, ThreadPool& pool, SourceSizes& sizes) const;
+	uint64_t GetInputHash(const Job& job, const Options& options, const SourceSizes& sizes) const;
+	static size_t MeasureSource(const Rom& rom, const Source& source);
+
+	size_t ExportTileset(const Job& job, const std::string& path) const;
+	size_t ExportBlockset(const Job& job, const std::string& path) const;
+	size_t ExportRoom(const Job& job, const Options& options, const std::string& path) const;
+	size_t ExportHeightmap(const Job& job, const std::string& path) const;
+	size_t ExportSpriteFrame(const Job& job, const SpriteFrame& frame, const std::string& path) const;
+	static size_t WritePNG(ImageBuffer& buffer, const std::vector<Palette>& pals, const std::string& path);
+
+	std::vector<Palette> GetPalettes(const Job& job) const;
+	std::vector<Palette> GetRoomPalettes(size_t room_palette) const;
+	size_t FindTilesetPalette(size_t tileset) const;
+	size_t FindBlocksetPalette(size_t blockset, size_t part) const;
+	std::shared_ptr<const std::vector<BigTile>> GetBlockset(size_t blockset, size_t part) const;
+	std::shared_ptr<RoomTilemap> GetRoomMap(size_t room) const;
+
+	std::shared_ptr<const Rom> m_rom;
+	RomTables m_tables;
+	AssetCache m_assets;
+	SpriteFrameStore m_spriteFrames;
+	// Sprite palettes are resolved lazily and are not safe to share between
+	// threads, so each frame's palette is looked up once, up front. A frame
+	// takes the palette of the first sprite that uses it.
+	std::vector<Palette> m_framePalettes;
+};
+
+#endif // BATCH_EXPORTER_H
@@ -12,7 +12,7 @@
 #include <sstream>
 #include "BitBarrel.h"
 #include "BigTile.h"
-#include <wx/msgdlg.h>
+#include <cassert>
 
 template<class T, size_t N>
 class TileQueue
@@ -153,6 +153,12 @@ void maskTiles(std::vector<Tile>& tiles, const TileAttributes::Attribute& attr,
 }
 
 uint16_t BigTilesCmp::Decode(const uint8_t* src, std::vector<BigTile>& tiles)
+{
+    size_t esize = 0;
+    return Decode(src, tiles, esize);
+}
+
+uint16_t BigTilesCmp::Decode(const uint8_t* src, std::vector<BigTile>& tiles, size_t& esize)
 {
     BitBarrel bb(src);
     TileQueue<uint16_t, 16> tq;
@@ -184,5 +190,7 @@ uint16_t BigTilesCmp::Decode(const uint8_t* src, std::vector<BigTile>& tiles)
     }
     wxMessageBox(ss.str());
     */
+    bb.advanceNextByte();
+    esize = bb.getBytePosition();
     return TOTAL;
 }
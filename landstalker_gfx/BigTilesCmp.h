@@ -9,6 +9,7 @@ class BigTilesCmp
 {
 public:
     static uint16_t Decode(const uint8_t* src, std::vector<BigTile>& tiles);
+    static uint16_t Decode(const uint8_t* src, std::vector<BigTile>& tiles, size_t& esize);
 private:
     BigTilesCmp();
 };
@@ -12,14 +12,12 @@ class Blockmap2D : public Tilemap
 public:
 	Blockmap2D(size_t width, size_t height, size_t left, size_t top, uint8_t palette);
 	virtual ~Blockmap2D() = default;
-	virtual TilePoint XYToTilePoint(const wxPoint& point) const;
-	virtual wxPoint ToXYPoint(const TilePoint& point) const;
+	virtual TilePoint XYToTilePoint(const Point& point) const;
+	virtual Point ToXYPoint(const TilePoint& point) const;
 	virtual void Draw(ImageBuffer& imgbuf) const;
-	void SetTileset(std::shared_ptr<Tileset> tileset);
-	std::shared_ptr<Tileset> GetTileset();
+	void SetTileset(std::shared_ptr<const Tileset> tileset);
 	std::shared_ptr<const Tileset> GetTileset() const;
-	void SetBlockset(std::shared_ptr<std::vector<BigTile>> blockset);
-	std::shared_ptr<std::vector<BigTile>> GetBlockset();
+	void SetBlockset(std::shared_ptr<const std::vector<BigTile>> blockset);
 	std::shared_ptr<const std::vector<BigTile>> GetBlockset() const;
 	const BigTile& GetBigTile(const TilePoint& point) const;
 	virtual size_t GetBitmapWidth() const;
@@ -30,8 +28,8 @@ protected:
 	const size_t TILEHEIGHT = 16;
 
 private:
-	std::shared_ptr<Tileset> m_tileset;
-	std::shared_ptr<std::vector<BigTile>> m_blockset;
+	std::shared_ptr<const Tileset> m_tileset;
+	std::shared_ptr<const std::vector<BigTile>> m_blockset;
 };
 
 #endif // TILEMAP2D_H
\ No newline at end of file
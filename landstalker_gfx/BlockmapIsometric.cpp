@@ -5,7 +5,7 @@ BlockmapIsometric::BlockmapIsometric(size_t width, size_t height, size_t left, s
 {
 }
 
-TilePoint BlockmapIsometric::XYToTilePoint(const wxPoint& point) const
+TilePoint BlockmapIsometric::XYToTilePoint(const Point& point) const
 {
 	TilePoint ret{ 0, 0 };
 	int xgrid = (point.x - GetLeft()) / TILEWIDTH;
@@ -15,18 +15,18 @@ TilePoint BlockmapIsometric::XYToTilePoint(const wxPoint& point) const
 	return ret;
 }
 
-wxPoint BlockmapIsometric::ToXYPoint(const TilePoint& point) const
+Point BlockmapIsometric::ToXYPoint(const TilePoint& point) const
 {
 	int ix = (point.x - point.y + (GetHeight() - 1)) * TILEWIDTH + GetLeft();
 	int iy = (point.x + point.y) * TILEHEIGHT / 2 + GetTop();
-	return wxPoint{ ix, iy };
+	return Point{ ix, iy };
 }
 
-wxPoint BlockmapIsometric::ToXYPoint3D(const TilePoint3D& point) const
+Point BlockmapIsometric::ToXYPoint3D(const TilePoint3D& point) const
 {
 	int ix = (point.x - point.y + (GetHeight() - 1)) * TILEWIDTH + GetLeft();
 	int iy = (point.x + point.y - point.z * 2) * TILEHEIGHT / 2 + GetTop();
-	return wxPoint{ ix, iy };
+	return Point{ ix, iy };
 }
 
 size_t BlockmapIsometric::GetBitmapWidth() const
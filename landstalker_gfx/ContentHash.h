@@ -0,0 +1,54 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// 64-bit FNV-1a hash, built up from any number of pieces. It is not
+// cryptographic: it only needs to tell whether the inputs to an image have
+// changed since it was last exported.
+class ContentHash
+{
+public:
+	ContentHash() : m_value(OFFSET_BASIS) {}
+
+	void Add(const uint8_t* data, size_t size)
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			m_value = (m_value ^ data[i]) * PRIME;
+		}
+	}
+
+	// Integers are added a byte at a time, low byte first, so the hash is
+	// the same whatever the host's byte order
+	template <class T>
+	void Add(T value)
+	{
+		static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "Only integers can be hashed by value");
+		uint64_t bits = static_cast<uint64_t>(value);
+		for (size_t i = 0; i < sizeof(T); ++i)
+		{
+			m_value = (m_value ^ (bits & 0xFF)) * PRIME;
+			bits >>= 8;
+		}
+	}
+
+	void Add(const std::string& text)
+	{
+		Add(text.size());
+		Add(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+	}
+
+	uint64_t GetValue() const { return m_value; }
+private:
+	static const uint64_t OFFSET_BASIS = 0xCBF29CE484222325ULL;
+	static const uint64_t PRIME = 0x100000001B3ULL;
+
+	uint64_t m_value;
+};
+
+#endif // CONTENT_HASH_H
@@ -0,0 +1,138 @@
+#include "ExportManifest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+
+namespace
+{
+bool FileExists(const std::string& path)
+{
+	std::ifstream infile(path, std::ios::in | std::ios::binary);
+	return infile.is_open();
+}
+
+// Hashes are kept as hex strings: JSON readers other than ours may hold
+// numbers as doubles, which can't represent every 64-bit value
+std::string FormatHash(uint64_t hash)
+{
+	std::ostringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return ss.str();
+}
+
+uint64_t ParseHash(const std::string& text)
+{
+	size_t end = 0;
+	const uint64_t hash = std::stoull(text, &end, 16);
+	if (end != text.size())
+	{
+		throw std::invalid_argument(text);
+	}
+	return hash;
+}
+}
+
+const unsigned ExportManifest::VERSION;
+
+ExportManifest::ExportManifest()
+{
+}
+
+// Returns false, leaving the manifest empty, if there is no manifest at the
+// path or it was written by a different version. A manifest that can't be
+// parsed is an error.
+bool ExportManifest::Load(const std::string& path)
+{
+	Clear();
+	std::ifstream infile(path);
+	if (!infile.is_open())
+	{
+		return false;
+	}
+	try
+	{
+		const nlohmann::json doc = nlohmann::json::parse(infile);
+		if (doc.at("version").get<unsigned>() != VERSION)
+		{
+			return false;
+		}
+		for (const auto& image : doc.at("images").items())
+		{
+			const Entry entry{ ParseHash(image.value().at("hash").get<std::string>()), image.value().at("pixels").get<size_t>() };
+			m_entries[image.key()] = entry;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		Clear();
+		std::ostringstream ss;
+		ss << "Unable to read export manifest \"" << path << "\": " << e.what();
+		throw std::runtime_error(ss.str());
+	}
+	return true;
+}
+
+void ExportManifest::Save(const std::string& path) const
+{
+	nlohmann::json images = nlohmann::json::object();
+	for (const auto& entry : m_entries)
+	{
+		images[entry.first] = { { "hash", FormatHash(entry.second.hash) }, { "pixels", entry.second.pixels } };
+	}
+	const nlohmann::json doc = { { "version", VERSION }, { "images", images } };
+
+	// Written to a temporary file first, so an interrupted save leaves the
+	// previous manifest intact
+	const std::string temp_path = path + ".tmp";
+	{
+		std::ofstream outfile(temp_path, std::ios::out | std::ios::trunc);
+		if (!outfile.is_open() || !(outfile << doc.dump(1, '\t') << std::endl))
+		{
+			throw std::runtime_error("Unable to write export manifest \"" + temp_path + "\"");
+		}
+	}
+	std::remove(path.c_str());
+	if (std::rename(temp_path.c_str(), path.c_str()) != 0)
+	{
+		throw std::runtime_error("Unable to write export manifest \"" + path + "\"");
+	}
+}
+
+void ExportManifest::Clear()
+{
+	m_entries.clear();
+}
+
+const ExportManifest::Entry* ExportManifest::Find(const std::string& filename) const
+{
+	auto it = m_entries.find(filename);
+	return (it != m_entries.end()) ? &it->second : nullptr;
+}
+
+// Whether the image recorded under the filename can be left alone: its hash
+// must match, and unless it was empty and never written, it must still be
+// at the given path
+bool ExportManifest::IsCurrent(const std::string& filename, uint64_t hash, const std::string& path) const
+{
+	const Entry* entry = Find(filename);
+	return (entry != nullptr) && (entry->hash == hash) && ((entry->pixels == 0) || FileExists(path));
+}
+
+void ExportManifest::Set(const std::string& filename, uint64_t hash, size_t pixels)
+{
+	m_entries[filename] = Entry{ hash, pixels };
+}
+
+void ExportManifest::Erase(const std::string& filename)
+{
+	m_entries.erase(filename);
+}
+
+size_t ExportManifest::size() const
+{
+	return m_entries.size();
+}
@@ -0,0 +1,38 @@
+#ifndef EXPORT_MANIFEST_H
+#define EXPORT_MANIFEST_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Records, for each exported image, a hash of everything that went into it.
+// An incremental export compares each image's current hash with the one
+// recorded here, and only renders the images whose inputs have changed.
+// Stored as JSON alongside the images.
+class ExportManifest
+{
+public:
+	static const unsigned VERSION = 1;
+
+	struct Entry
+	{
+		uint64_t hash;
+		// Images with nothing in them are recorded but never written
+		size_t pixels;
+	};
+
+	ExportManifest();
+
+	bool Load(const std::string& path);
+	void Save(const std::string& path) const;
+	void Clear();
+	const Entry* Find(const std::string& filename) const;
+	bool IsCurrent(const std::string& filename, uint64_t hash, const std::string& path) const;
+	void Set(const std::string& filename, uint64_t hash, size_t pixels);
+	void Erase(const std::string& filename);
+	size_t size() const;
+private:
+	std::map<std::string, Entry> m_entries;
+};
+
+#endif // EXPORT_MANIFEST_H
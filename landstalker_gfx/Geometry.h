@@ -0,0 +1,63 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <algorithm>
+
+// Pixel coordinates, kept free of any GUI toolkit so that the core library
+// can be built on its own. WxAdapter.h converts to and from the wx types.
+struct Point
+{
+	Point(int x_in = 0, int y_in = 0) : x(x_in), y(y_in) {}
+
+	bool operator==(const Point& rhs) const { return (x == rhs.x) && (y == rhs.y); }
+	bool operator!=(const Point& rhs) const { return !(*this == rhs); }
+
+	int x;
+	int y;
+};
+
+struct Rect
+{
+	Rect(int x_in = 0, int y_in = 0, int width_in = 0, int height_in = 0)
+		: x(x_in), y(y_in), width(width_in), height(height_in) {}
+
+	int GetLeft() const { return x; }
+	int GetTop() const { return y; }
+	int GetRight() const { return x + width; }
+	int GetBottom() const { return y + height; }
+	bool IsEmpty() const { return (width <= 0) || (height <= 0); }
+
+	bool Contains(const Point& point) const
+	{
+		return (point.x >= x) && (point.x < GetRight()) && (point.y >= y) && (point.y < GetBottom());
+	}
+
+	Rect Intersect(const Rect& rhs) const
+	{
+		const int left = std::max(x, rhs.x);
+		const int top = std::max(y, rhs.y);
+		const int right = std::min(GetRight(), rhs.GetRight());
+		const int bottom = std::min(GetBottom(), rhs.GetBottom());
+		if ((right <= left) || (bottom <= top))
+		{
+			return Rect();
+		}
+		return Rect(left, top, right - left, bottom - top);
+	}
+
+	Rect Union(const Rect& rhs) const
+	{
+		if (IsEmpty()) return rhs;
+		if (rhs.IsEmpty()) return *this;
+		const int left = std::min(x, rhs.x);
+		const int top = std::min(y, rhs.y);
+		return Rect(left, top, std::max(GetRight(), rhs.GetRight()) - left, std::max(GetBottom(), rhs.GetBottom()) - top);
+	}
+
+	int x;
+	int y;
+	int width;
+	int height;
+};
+
+#endif // GEOMETRY_H
@@ -0,0 +1,98 @@
+#include "GlyphAtlas.h"
+
+namespace
+{
+const char GLYPH_CHARS[] = "0123456789ABCDEF,";
+const size_t GLYPH_COUNT = sizeof(GLYPH_CHARS) - 1;
+
+// One byte per row, leftmost pixel in bit 4
+const uint8_t GLYPH_ROWS[GLYPH_COUNT][GlyphAtlas::GLYPH_HEIGHT] = {
+	{ 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E }, // 0
+	{ 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E }, // 1
+	{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F }, // 2
+	{ 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E }, // 3
+	{ 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 }, // 4
+	{ 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E }, // 5
+	{ 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E }, // 6
+	{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, // 7
+	{ 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E }, // 8
+	{ 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C }, // 9
+	{ 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // A
+	{ 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E }, // B
+	{ 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E }, // C
+	{ 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C }, // D
+	{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F }, // E
+	{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 }, // F
+	{ 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 }  // ,
+};
+}
+
+GlyphAtlas::GlyphAtlas(size_t scale)
+	: m_scale(scale > 0 ? scale : 1),
+	  m_mask(GLYPH_COUNT * GLYPH_WIDTH * GLYPH_HEIGHT * m_scale * m_scale, 0)
+{
+	// Glyphs sit side by side, so each one is GetStride() bytes per row
+	const size_t stride = GetStride();
+	for (size_t g = 0; g < GLYPH_COUNT; ++g)
+	{
+		for (size_t y = 0; y < GLYPH_HEIGHT * m_scale; ++y)
+		{
+			const uint8_t row = GLYPH_ROWS[g][y / m_scale];
+			for (size_t x = 0; x < GLYPH_WIDTH * m_scale; ++x)
+			{
+				if (row & (0x10 >> (x / m_scale)))
+				{
+					m_mask[y * stride + g * GLYPH_WIDTH * m_scale + x] = 0xFF;
+				}
+			}
+		}
+	}
+}
+
+// Returns the top-left of the glyph's mask, or nullptr for a character the
+// font does not cover. Lower case hex digits share the upper case glyphs.
+const uint8_t* GlyphAtlas::GetGlyph(char c) const
+{
+	if ((c >= 'a') && (c <= 'f'))
+	{
+		c = c - 'a' + 'A';
+	}
+	for (size_t g = 0; g < GLYPH_COUNT; ++g)
+	{
+		if (GLYPH_CHARS[g] == c)
+		{
+			return &m_mask[g * GLYPH_WIDTH * m_scale];
+		}
+	}
+	return nullptr;
+}
+
+size_t GlyphAtlas::GetStride() const
+{
+	return GLYPH_COUNT * GLYPH_WIDTH * m_scale;
+}
+
+size_t GlyphAtlas::GetGlyphWidth() const
+{
+	return GLYPH_WIDTH * m_scale;
+}
+
+size_t GlyphAtlas::GetGlyphHeight() const
+{
+	return GLYPH_HEIGHT * m_scale;
+}
+
+// Glyphs are separated by one (scaled) column of space
+size_t GlyphAtlas::GetAdvance() const
+{
+	return (GLYPH_WIDTH + 1) * m_scale;
+}
+
+size_t GlyphAtlas::GetTextWidth(const std::string& text) const
+{
+	if (text.empty())
+	{
+		return 0;
+	}
+	return text.size() * GetAdvance() - m_scale;
+}
@@ -0,0 +1,30 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A small built-in bitmap font covering the hex digits and ',', rasterised
+// once at a fixed scale into a single coverage mask. Drawing a label is then
+// a few masked copies, with no font engine or text measurement involved.
+class GlyphAtlas
+{
+public:
+	static const size_t GLYPH_WIDTH = 5;
+	static const size_t GLYPH_HEIGHT = 7;
+
+	explicit GlyphAtlas(size_t scale = 1);
+
+	const uint8_t* GetGlyph(char c) const;
+	size_t GetStride() const;
+	size_t GetGlyphWidth() const;
+	size_t GetGlyphHeight() const;
+	size_t GetAdvance() const;
+	size_t GetTextWidth(const std::string& text) const;
+private:
+	size_t m_scale;
+	std::vector<uint8_t> m_mask;
+};
+
+#endif // GLYPH_ATLAS_H
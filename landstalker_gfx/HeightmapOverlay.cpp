@@ -0,0 +1,213 @@
+#include "HeightmapOverlay.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+struct Colour
+{
+	uint8_t r;
+	uint8_t g;
+	uint8_t b;
+
+	Colour Darken() const
+	{
+		// Matches wxColour::ChangeLightness(70)
+		const Colour dark = { static_cast<uint8_t>((r * 7 + 5) / 10),
+		                      static_cast<uint8_t>((g * 7 + 5) / 10),
+		                      static_cast<uint8_t>((b * 7 + 5) / 10) };
+		return dark;
+	}
+};
+
+Colour GetCellColour(unsigned z, uint8_t restrictions)
+{
+	Colour c;
+	switch (restrictions)
+	{
+	case 0x0:
+		c = { static_cast<uint8_t>(z * 3), static_cast<uint8_t>(48 + z * 8), static_cast<uint8_t>(z * 3) };
+		break;
+	case 0x4:
+		c = { static_cast<uint8_t>(48 + z * 8), static_cast<uint8_t>(z * 3), static_cast<uint8_t>(z * 3) };
+		break;
+	case 0x2:
+		c = { static_cast<uint8_t>(32 + z * 3), static_cast<uint8_t>(32 + z * 3), static_cast<uint8_t>(48 + z * 12) };
+		break;
+	case 0x6:
+		c = { static_cast<uint8_t>(48 + z * 8), static_cast<uint8_t>(32 + z * 3), static_cast<uint8_t>(48 + z * 8) };
+		break;
+	default:
+		c = { static_cast<uint8_t>(48 + z * 8), static_cast<uint8_t>(48 + z * 8), static_cast<uint8_t>(z * 3) };
+		break;
+	}
+	return c;
+}
+
+const char HEX_DIGITS[] = "0123456789ABCDEF";
+}
+
+HeightmapOverlay::HeightmapOverlay(size_t cell_width, size_t cell_height)
+	: m_cell_width(cell_width), m_cell_height(cell_height)
+{
+}
+
+// Draws the overlay over the same area as the room's foreground layer. Cells
+// are painted back to front, exactly as the map stores them.
+void HeightmapOverlay::Draw(const RoomTilemap& map, std::vector<uint8_t>& rgba)
+{
+	const size_t width = map.foreground.GetBitmapWidth();
+	const size_t height = map.foreground.GetBitmapHeight();
+	rgba.assign(width * height * 4, 0);
+
+	size_t p = 0;
+	for (size_t y = 0; y < map.hmheight; ++y)
+	{
+		for (size_t x = 0; x < map.hmwidth; ++x, ++p)
+		{
+			const HeightMapCell& cell = map.heightmap[p];
+			// Only display cells that are not completely restricted
+			if ((cell.height == 0) && (cell.restrictions == 0x04))
+			{
+				continue;
+			}
+			const size_t xx = x - map.GetLeft() + 12;
+			const size_t yy = y - map.GetTop() + 12;
+			const Point xy(map.foreground.ToXYPoint3D(TilePoint3D{ xx, yy, cell.height }));
+			BlitCell(GetCellSprite(cell.height, cell.restrictions), xy.x, xy.y, rgba, width, height);
+			if (cell.classification != 0)
+			{
+				DrawLabel(cell.classification, xy.x, xy.y, rgba, width, height);
+			}
+		}
+	}
+}
+
+size_t HeightmapOverlay::GetCachedSpriteCount() const
+{
+	return m_sprites.size();
+}
+
+const HeightmapOverlay::CellSprite& HeightmapOverlay::GetCellSprite(uint8_t height, uint8_t restrictions)
+{
+	const uint16_t key = (height << 8) | restrictions;
+	auto it = m_sprites.find(key);
+	if (it == m_sprites.end())
+	{
+		it = m_sprites.insert(std::make_pair(key, MakeCellSprite(height, restrictions))).first;
+	}
+	return it->second;
+}
+
+// The top face is a diamond filling the cell; the left and right walls hang
+// from its two lower edges, one cell height per unit of height. Pixels are
+// sampled at their centres, and the walls win on shared edges, as they are
+// drawn last.
+HeightmapOverlay::CellSprite HeightmapOverlay::MakeCellSprite(uint8_t height, uint8_t restrictions) const
+{
+	const double w = static_cast<double>(m_cell_width);
+	const double h = static_cast<double>(m_cell_height);
+	const double wall = h * height;
+	const Colour top = GetCellColour(height, restrictions);
+	const Colour left = top.Darken();
+	const Colour right = left.Darken();
+
+	CellSprite sprite;
+	sprite.height = m_cell_height * (height + 1);
+	sprite.rgba.assign(m_cell_width * sprite.height * 4, 0);
+	sprite.row_begin.assign(sprite.height, m_cell_width);
+	sprite.row_end.assign(sprite.height, 0);
+	for (size_t py = 0; py < sprite.height; ++py)
+	{
+		for (size_t px = 0; px < m_cell_width; ++px)
+		{
+			const double cx = px + 0.5;
+			const double cy = py + 0.5;
+			const Colour* colour = nullptr;
+			if (cx < w / 2)
+			{
+				const double edge = h / 2 + cx * h / w;
+				if ((cy >= edge) && (cy <= edge + wall))
+				{
+					colour = &left;
+				}
+			}
+			else
+			{
+				const double edge = h - (cx - w / 2) * h / w;
+				if ((cy >= edge) && (cy <= edge + wall))
+				{
+					colour = &right;
+				}
+			}
+			if ((colour == nullptr) && (std::abs(cx - w / 2) / (w / 2) + std::abs(cy - h / 2) / (h / 2) <= 1.0))
+			{
+				colour = &top;
+			}
+			if (colour != nullptr)
+			{
+				uint8_t* dest = &sprite.rgba[(py * m_cell_width + px) * 4];
+				dest[0] = colour->r;
+				dest[1] = colour->g;
+				dest[2] = colour->b;
+				dest[3] = 0xFF;
+				sprite.row_begin[py] = std::min(sprite.row_begin[py], px);
+				sprite.row_end[py] = px + 1;
+			}
+		}
+	}
+	return sprite;
+}
+
+void HeightmapOverlay::BlitCell(const CellSprite& sprite, int x, int y, std::vector<uint8_t>& rgba, size_t width, size_t height) const
+{
+	for (size_t row = 0; row < sprite.height; ++row)
+	{
+		const int dest_y = y + static_cast<int>(row);
+		if ((dest_y < 0) || (dest_y >= static_cast<int>(height)) || (sprite.row_begin[row] >= sprite.row_end[row]))
+		{
+			continue;
+		}
+		const int begin = std::max(x + static_cast<int>(sprite.row_begin[row]), 0);
+		const int end = std::min(x + static_cast<int>(sprite.row_end[row]), static_cast<int>(width));
+		if (begin >= end)
+		{
+			continue;
+		}
+		const uint8_t* src = &sprite.rgba[(row * m_cell_width + (begin - x)) * 4];
+		std::copy(src, src + (end - begin) * 4, &rgba[(dest_y * width + begin) * 4]);
+	}
+}
+
+// The label is two white hex digits, centred on the cell's top face
+void HeightmapOverlay::DrawLabel(uint8_t classification, int x, int y, std::vector<uint8_t>& rgba, size_t width, size_t height) const
+{
+	const char label[2] = { HEX_DIGITS[classification >> 4], HEX_DIGITS[classification & 0x0F] };
+	const size_t glyph_width = m_glyphs.GetGlyphWidth();
+	const size_t glyph_height = m_glyphs.GetGlyphHeight();
+	const size_t stride = m_glyphs.GetStride();
+	int gx = x + (static_cast<int>(m_cell_width) - static_cast<int>(m_glyphs.GetTextWidth(std::string(label, 2)))) / 2;
+	const int gy = y + (static_cast<int>(m_cell_height) - static_cast<int>(glyph_height)) / 2;
+	for (char c : label)
+	{
+		const uint8_t* glyph = m_glyphs.GetGlyph(c);
+		for (size_t row = 0; row < glyph_height; ++row)
+		{
+			const int dest_y = gy + static_cast<int>(row);
+			if ((dest_y < 0) || (dest_y >= static_cast<int>(height)))
+			{
+				continue;
+			}
+			for (size_t col = 0; col < glyph_width; ++col)
+			{
+				const int dest_x = gx + static_cast<int>(col);
+				if ((glyph[row * stride + col] != 0) && (dest_x >= 0) && (dest_x < static_cast<int>(width)))
+				{
+					std::fill_n(&rgba[(dest_y * width + dest_x) * 4], 4, 0xFF);
+				}
+			}
+		}
+		gx += static_cast<int>(m_glyphs.GetAdvance());
+	}
+}
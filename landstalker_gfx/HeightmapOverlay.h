@@ -0,0 +1,44 @@
+#ifndef HEIGHTMAP_OVERLAY_H
+#define HEIGHTMAP_OVERLAY_H
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "LSTilemapCmp.h"
+#include "GlyphAtlas.h"
+
+// Rasterises the isometric heightmap overlay of a room straight into an RGBA
+// buffer. Every cell with the same height and restrictions looks the same, so
+// each such cell is drawn once into a sprite and reused; only the
+// classification labels differ, and those come from a glyph atlas. The
+// overlay is drawn fully opaque, leaving opacity to the compositor.
+class HeightmapOverlay
+{
+public:
+	HeightmapOverlay(size_t cell_width = 32, size_t cell_height = 16);
+
+	void Draw(const RoomTilemap& map, std::vector<uint8_t>& rgba);
+	size_t GetCachedSpriteCount() const;
+private:
+	// A cell's top face and the two walls below it, drawn as RGBA rows. The
+	// outline is convex, so each row is a single run of opaque pixels.
+	struct CellSprite
+	{
+		size_t height;
+		std::vector<uint8_t> rgba;
+		std::vector<size_t> row_begin;
+		std::vector<size_t> row_end;
+	};
+
+	const CellSprite& GetCellSprite(uint8_t height, uint8_t restrictions);
+	CellSprite MakeCellSprite(uint8_t height, uint8_t restrictions) const;
+	void BlitCell(const CellSprite& sprite, int x, int y, std::vector<uint8_t>& rgba, size_t width, size_t height) const;
+	void DrawLabel(uint8_t classification, int x, int y, std::vector<uint8_t>& rgba, size_t width, size_t height) const;
+
+	const size_t m_cell_width;
+	const size_t m_cell_height;
+	GlyphAtlas m_glyphs;
+	std::map<uint16_t, CellSprite> m_sprites;
+};
+
+#endif // HEIGHTMAP_OVERLAY_H
@@ -0,0 +1,159 @@
+#include "HeightmapView.h"
+
+#include <algorithm>
+
+namespace
+{
+const char HEX_DIGITS[] = "0123456789ABCDEF";
+const size_t MAX_HEIGHT = 15;
+const size_t HATCH_SPACING = 6;
+}
+
+HeightmapView::HeightmapView(size_t cell_size)
+	: m_cell_size(cell_size), m_palettes(4)
+{
+	// Passable cells are green, fully restricted red, restriction 0x2 blue
+	// and any other combination yellow. Brighter is higher.
+	for (size_t p = 0; p < m_palettes.size(); ++p)
+	{
+		Palette& pal = m_palettes[p];
+		pal.set(COLOUR_CLEAR, 0x00, 0x00, 0x00, 0x00);
+		for (uint8_t c = COLOUR_HEIGHT_FIRST; c <= COLOUR_HEIGHT_LAST; ++c)
+		{
+			const uint8_t level = 40 + (c - COLOUR_HEIGHT_FIRST) * 17;
+			const uint8_t dim = level / 4;
+			switch (p)
+			{
+			case 0: pal.set(c, dim, level, dim); break;
+			case 1: pal.set(c, level, dim, dim); break;
+			case 2: pal.set(c, dim, dim, level); break;
+			default: pal.set(c, level, level, dim); break;
+			}
+		}
+		pal.set(COLOUR_DARK, 0x10, 0x10, 0x10);
+		pal.set(COLOUR_LIGHT, 0xFF, 0xFF, 0xFF);
+	}
+}
+
+// The buffer is resized to fit the map. Completely restricted cells at
+// ground level are left clear, as in the isometric overlay.
+void HeightmapView::Draw(const RoomTilemap& map, ImageBuffer& buffer)
+{
+	buffer.Resize(GetBitmapWidth(map), GetBitmapHeight(map));
+	const int line_height = static_cast<int>(m_glyphs.GetGlyphHeight() + 2);
+	size_t p = 0;
+	for (size_t y = 0; y < map.hmheight; ++y)
+	{
+		for (size_t x = 0; x < map.hmwidth; ++x, ++p)
+		{
+			const HeightMapCell& cell = map.heightmap[p];
+			if ((cell.height == 0) && (cell.restrictions == 0x04))
+			{
+				continue;
+			}
+			const ImageBuffer& stamp = GetCell(cell.height, cell.restrictions);
+			buffer.Blit(x * m_cell_size, y * m_cell_size, stamp, 0, 0, stamp.GetWidth(), stamp.GetHeight());
+			const char label[2] = { HEX_DIGITS[cell.classification >> 4], HEX_DIGITS[cell.classification & 0x0F] };
+			DrawText(buffer, static_cast<int>(x * m_cell_size + 2), static_cast<int>(y * m_cell_size + 2) + line_height,
+			         std::string(label, 2), GetPaletteIndex(cell.restrictions), GetTextColour(cell.height));
+		}
+	}
+}
+
+const std::vector<Palette>& HeightmapView::GetPalettes() const
+{
+	return m_palettes;
+}
+
+// Cells share their borders, so the view is one pixel larger than the cells
+size_t HeightmapView::GetBitmapWidth(const RoomTilemap& map) const
+{
+	return map.hmwidth * m_cell_size + 1;
+}
+
+size_t HeightmapView::GetBitmapHeight(const RoomTilemap& map) const
+{
+	return map.hmheight * m_cell_size + 1;
+}
+
+size_t HeightmapView::GetCachedCellCount() const
+{
+	return m_cells.size();
+}
+
+const ImageBuffer& HeightmapView::GetCell(uint8_t height, uint8_t restrictions)
+{
+	const uint16_t key = (height << 8) | restrictions;
+	auto it = m_cells.find(key);
+	if (it == m_cells.end())
+	{
+		it = m_cells.insert(std::make_pair(key, MakeCell(height, restrictions))).first;
+	}
+	return it->second;
+}
+
+// A cell is its height colour inside a light border, with the height and
+// restrictions written on its first line. Restriction bit 0x4 hatches one
+// diagonal, 0x2 the other, and the remaining bits horizontally.
+ImageBuffer HeightmapView::MakeCell(uint8_t height, uint8_t restrictions) const
+{
+	const size_t size = m_cell_size + 1;
+	const uint8_t pal = GetPaletteIndex(restrictions);
+	ImageBuffer cell(size, size);
+	cell.FillRect(0, 0, size, size, pal, COLOUR_LIGHT);
+	cell.FillRect(1, 1, size - 2, size - 2, pal, GetHeightColour(height));
+
+	std::vector<uint8_t> hatch((size - 2) * (size - 2), 0);
+	for (size_t y = 0; y < size - 2; ++y)
+	{
+		for (size_t x = 0; x < size - 2; ++x)
+		{
+			const bool back = (restrictions & 0x4) && ((x + y) % HATCH_SPACING == 0);
+			const bool forward = (restrictions & 0x2) && ((x + size - y) % HATCH_SPACING == 0);
+			const bool across = (restrictions & 0x9) && (y % HATCH_SPACING == HATCH_SPACING / 2);
+			hatch[y * (size - 2) + x] = (back || forward || across) ? 0xFF : 0x00;
+		}
+	}
+	cell.InsertMask(1, 1, hatch.data(), size - 2, size - 2, size - 2, pal, COLOUR_DARK);
+
+	const char label[3] = { HEX_DIGITS[height & 0x0F], ',', HEX_DIGITS[restrictions & 0x0F] };
+	DrawText(cell, 2, 2, std::string(label, 3), pal, GetTextColour(height));
+	return cell;
+}
+
+void HeightmapView::DrawText(ImageBuffer& buffer, int x, int y, const std::string& text, uint8_t palette_index, uint8_t colour) const
+{
+	for (char c : text)
+	{
+		const uint8_t* glyph = m_glyphs.GetGlyph(c);
+		if (glyph != nullptr)
+		{
+			buffer.InsertMask(x, y, glyph, m_glyphs.GetGlyphWidth(), m_glyphs.GetGlyphHeight(), m_glyphs.GetStride(), palette_index, colour);
+		}
+		x += static_cast<int>(m_glyphs.GetAdvance());
+	}
+}
+
+uint8_t HeightmapView::GetPaletteIndex(uint8_t restrictions)
+{
+	switch (restrictions)
+	{
+	case 0x0: return 0;
+	case 0x4: return 1;
+	case 0x2: return 2;
+	default: return 3;
+	}
+}
+
+uint8_t HeightmapView::GetHeightColour(uint8_t height)
+{
+	const size_t steps = COLOUR_HEIGHT_LAST - COLOUR_HEIGHT_FIRST;
+	return COLOUR_HEIGHT_FIRST + static_cast<uint8_t>((std::min<size_t>(height, MAX_HEIGHT) * steps + MAX_HEIGHT / 2) / MAX_HEIGHT);
+}
+
+// Labels stay readable by switching to dark text on the brighter half of
+// the ramp
+uint8_t HeightmapView::GetTextColour(uint8_t height)
+{
+	return (GetHeightColour(height) > (COLOUR_HEIGHT_FIRST + COLOUR_HEIGHT_LAST) / 2) ? COLOUR_DARK : COLOUR_LIGHT;
+}
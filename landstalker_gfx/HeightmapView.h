@@ -0,0 +1,55 @@
+#ifndef HEIGHTMAP_VIEW_H
+#define HEIGHTMAP_VIEW_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "LSTilemapCmp.h"
+#include "ImageBuffer.h"
+#include "Palette.h"
+#include "GlyphAtlas.h"
+
+// Top-down view of a room's heightmap, drawn into an ImageBuffer with its own
+// palettes. Each cell is coloured by its height, using one palette per kind
+// of restriction, hatched by its restriction bits and labelled with its
+// height, restrictions and classification. Cells are stamped from images
+// cached by height and restrictions, so a redraw is mostly row copies.
+class HeightmapView
+{
+public:
+	static const size_t DEFAULT_CELL_SIZE = 32;
+
+	explicit HeightmapView(size_t cell_size = DEFAULT_CELL_SIZE);
+
+	void Draw(const RoomTilemap& map, ImageBuffer& buffer);
+	const std::vector<Palette>& GetPalettes() const;
+	size_t GetBitmapWidth(const RoomTilemap& map) const;
+	size_t GetBitmapHeight(const RoomTilemap& map) const;
+	size_t GetCachedCellCount() const;
+private:
+	// Colours 1-13 of each palette are the height ramp
+	enum PaletteColour
+	{
+		COLOUR_CLEAR = 0,
+		COLOUR_HEIGHT_FIRST = 1,
+		COLOUR_HEIGHT_LAST = 13,
+		COLOUR_DARK = 14,
+		COLOUR_LIGHT = 15
+	};
+
+	const ImageBuffer& GetCell(uint8_t height, uint8_t restrictions);
+	ImageBuffer MakeCell(uint8_t height, uint8_t restrictions) const;
+	void DrawText(ImageBuffer& buffer, int x, int y, const std::string& text, uint8_t palette_index, uint8_t colour) const;
+
+	static uint8_t GetPaletteIndex(uint8_t restrictions);
+	static uint8_t GetHeightColour(uint8_t height);
+	static uint8_t GetTextColour(uint8_t height);
+
+	const size_t m_cell_size;
+	GlyphAtlas m_glyphs;
+	std::vector<Palette> m_palettes;
+	std::map<uint16_t, ImageBuffer> m_cells;
+};
+
+#endif // HEIGHTMAP_VIEW_H
@@ -1,9 +1,49 @@
 #include "ImageBuffer.h"
 
+#include <algorithm>
 #include <cassert>
 #include <png.h>
+#include <zlib.h>
+#include "Log.h"
+#include "SpriteTileStore.h"
 #include "Utils.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define IMAGE_BUFFER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// Writes one row of sprite pixels, leaving the destination untouched where
+// the source is transparent (colour 0). Sprites are drawn at low priority.
+inline void StoreMaskedRow(uint8_t* dest, uint8_t* priority, const uint8_t* src, uint8_t pal_bits, size_t count)
+{
+#ifdef IMAGE_BUFFER_USE_SSE2
+    if (count == 8)
+    {
+        const __m128i pixels = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+        const __m128i transparent = _mm_cmpeq_epi8(pixels, _mm_setzero_si128());
+        const __m128i coloured = _mm_or_si128(pixels, _mm_set1_epi8(static_cast<char>(pal_bits)));
+        const __m128i old_pixels = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(dest));
+        const __m128i old_priority = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(priority));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest),
+            _mm_or_si128(_mm_and_si128(transparent, old_pixels), _mm_andnot_si128(transparent, coloured)));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(priority), _mm_and_si128(transparent, old_priority));
+        return;
+    }
+#endif
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (src[i] != 0)
+        {
+            dest[i] = src[i] | pal_bits;
+            priority[i] = 0;
+        }
+    }
+}
+}
+
 ImageBuffer::ImageBuffer()
     : m_width(0), m_height(0)
 {}
@@ -36,10 +76,8 @@ void ImageBuffer::InsertTile(size_t x, size_t y, uint8_t palette_index, const Ti
     size_t max_y = y + 7;
     if ((max_x >= m_width) || (max_y >= m_height))
     {
-        std::ostringstream ss;
-        ss << "Attempt to draw tile in out-of-range position " << x << ", " << y 
-           << " : The image buffer is only " << m_width << " x " << m_height << " pixels." << std::endl;
-        Debug(ss.str());
+        LOG_WARNING(Log::CAT_IMAGE, "Attempt to draw tile in out-of-range position " << x << ", " << y
+           << " : The image buffer is only " << m_width << " x " << m_height << " pixels.");
     }
     else
     {
@@ -134,6 +172,63 @@ bool ImageBuffer::WritePNG(const std::string& filename, const std::vector<Palett
     return retval;
 }
 
+// Writes already-converted pixels, three bytes (R, G, B) per pixel, such as
+// a composite of several layers that no longer fits a palette.
+bool ImageBuffer::WritePNG(const std::string& filename, const std::vector<uint8_t>& rgb, size_t width, size_t height)
+{
+    bool retval = false;
+    if (rgb.size() != width * height * 3)
+    {
+        return retval;
+    }
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png_create_info_struct(png);
+    if (setjmp(png_jmpbuf(png))) abort();
+
+    png_set_IHDR(
+        png,
+        info,
+        width, height,
+        8,
+        PNG_COLOR_TYPE_RGB,
+        PNG_INTERLACE_NONE,
+        PNG_COMPRESSION_TYPE_BASE,
+        PNG_FILTER_TYPE_BASE
+    );
+    // Full colour images are three times the size of paletted ones, and the
+    // default level spends most of the write time compressing them for files
+    // that are only slightly smaller
+    png_set_compression_level(png, Z_BEST_SPEED);
+
+    FILE* fp = fopen(filename.c_str(), "wb");
+
+    if (fp != NULL)
+    {
+        png_init_io(png, fp);
+        png_write_info(png, info);
+
+        const uint8_t* row = rgb.data();
+        for (size_t y = 0; y < height; ++y)
+        {
+            png_write_row(png, row);
+            row += width * 3;
+        }
+
+        png_write_end(png, info);
+        fclose(fp);
+        retval = true;
+    }
+    else
+    {
+        Debug("Unable to open PNG!");
+    }
+
+    png_destroy_write_struct(&png, &info);
+
+    return retval;
+}
+
 void ImageBuffer::InsertBlock(size_t x, size_t y, uint8_t palette_index, const BigTile& block, const Tileset& tileset)
 {
     if ((y + 7) * m_width + x + 7 < m_pixels.size())
@@ -150,15 +245,171 @@ void ImageBuffer::InsertBlock(size_t x, size_t y, uint8_t palette_index, const B
     }
 }
 
+// Draws a whole sprite frame with its origin at (x, y). The frame may lie
+// partly or wholly outside the buffer; only the visible pixels are written.
+// Flipping mirrors the sprite about its origin, as the hardware does.
+void ImageBuffer::InsertSprite(int x, int y, uint8_t palette_index, const SpriteFrame& frame, bool hflip, bool vflip)
+{
+    InsertSubSprites(x, y, palette_index << 4, frame.m_subsprites, hflip, vflip,
+        [&frame](size_t index, bool&, bool&) { return frame.m_sprite_gfx.getTilePixels(index); });
+}
+
+// As above, drawing frame number 'frame' from a shared tile store. A stored
+// tile may itself be a mirror image of the frame's tile, and that flip is
+// combined with the sprite's own.
+void ImageBuffer::InsertSprite(int x, int y, uint8_t palette_index, const SpriteTileStore& tiles, size_t frame, bool hflip, bool vflip)
+{
+    const size_t tile_count = tiles.GetFrameTileCount(frame);
+    InsertSubSprites(x, y, palette_index << 4, tiles.GetSubSprites(frame), hflip, vflip,
+        [&tiles, frame, tile_count](size_t index, bool& tile_hflip, bool& tile_vflip) -> const uint8_t*
+        {
+            if (index >= tile_count)
+            {
+                return nullptr;
+            }
+            const SpriteTileStore::TileRef ref = tiles.GetTileRef(frame, index);
+            tile_hflip ^= (ref.flip & SpriteTileStore::FLIP_H) != 0;
+            tile_vflip ^= (ref.flip & SpriteTileStore::FLIP_V) != 0;
+            return tiles.GetTilePixels(ref.id);
+        });
+}
+
+// Lays out the subsprites for both kinds of InsertSprite. The tile source
+// returns the pixels of the tile with the given index, adjusting the flips
+// it is drawn with if need be, or null if there is no such tile.
+template <class TileSource>
+void ImageBuffer::InsertSubSprites(int x, int y, uint8_t pal_bits, const std::vector<SpriteFrame::SubSprite>& subsprites, bool hflip, bool vflip, TileSource tile_source)
+{
+    for (const auto& subs : subsprites)
+    {
+        int left = SpriteFrame::SubSpriteOffset(subs.x);
+        int top = SpriteFrame::SubSpriteOffset(subs.y);
+        if (hflip)
+        {
+            left = -(left + static_cast<int>(subs.w * 8));
+        }
+        if (vflip)
+        {
+            top = -(top + static_cast<int>(subs.h * 8));
+        }
+        // Tiles within a subsprite run down each column before moving right
+        size_t index = subs.tile_idx;
+        for (size_t tx = 0; tx < subs.w; ++tx)
+        {
+            const size_t col = hflip ? (subs.w - 1 - tx) : tx;
+            for (size_t ty = 0; ty < subs.h; ++ty)
+            {
+                const size_t row = vflip ? (subs.h - 1 - ty) : ty;
+                bool tile_hflip = hflip;
+                bool tile_vflip = vflip;
+                const uint8_t* pixels = tile_source(index++, tile_hflip, tile_vflip);
+                if (pixels != nullptr)
+                {
+                    InsertSpriteTile(x + left + static_cast<int>(col * 8), y + top + static_cast<int>(row * 8),
+                        pal_bits, pixels, tile_hflip, tile_vflip);
+                }
+            }
+        }
+    }
+}
+
+void ImageBuffer::InsertSpriteTile(int x, int y, uint8_t pal_bits, const uint8_t* pixels, bool hflip, bool vflip)
+{
+    const int width = static_cast<int>(m_width);
+    const int height = static_cast<int>(m_height);
+    if ((x >= width) || (y >= height) || (x + 8 <= 0) || (y + 8 <= 0))
+    {
+        return;
+    }
+    const int col_begin = std::max(0, -x);
+    const int col_end = std::min(8, width - x);
+    const int row_begin = std::max(0, -y);
+    const int row_end = std::min(8, height - y);
+    uint8_t row_pixels[8];
+    for (int row = row_begin; row < row_end; ++row)
+    {
+        const uint8_t* src = pixels + 8 * (vflip ? (7 - row) : row);
+        if (hflip)
+        {
+            std::reverse_copy(src, src + 8, row_pixels);
+        }
+        else
+        {
+            std::copy(src, src + 8, row_pixels);
+        }
+        const size_t offset = (y + row) * m_width + x + col_begin;
+        StoreMaskedRow(&m_pixels[offset], &m_priority[offset], row_pixels + col_begin, pal_bits, col_end - col_begin);
+    }
+}
+
+void ImageBuffer::Blit(size_t x, size_t y, const ImageBuffer& src, size_t src_x, size_t src_y, size_t width, size_t height)
+{
+    if ((x >= m_width) || (y >= m_height) || (src_x >= src.m_width) || (src_y >= src.m_height))
+    {
+        return;
+    }
+    width = std::min(std::min(width, m_width - x), src.m_width - src_x);
+    height = std::min(std::min(height, m_height - y), src.m_height - src_y);
+    for (size_t row = 0; row < height; ++row)
+    {
+        const size_t src_offset = (src_y + row) * src.m_width + src_x;
+        const size_t dest_offset = (y + row) * m_width + x;
+        std::copy_n(src.m_pixels.begin() + src_offset, width, m_pixels.begin() + dest_offset);
+        std::copy_n(src.m_priority.begin() + src_offset, width, m_priority.begin() + dest_offset);
+    }
+}
+
+void ImageBuffer::FillRect(size_t x, size_t y, size_t width, size_t height, uint8_t palette_index, uint8_t colour)
+{
+    if ((x >= m_width) || (y >= m_height))
+    {
+        return;
+    }
+    width = std::min(width, m_width - x);
+    height = std::min(height, m_height - y);
+    const uint8_t pixel = (palette_index << 4) | (colour & 0x0F);
+    for (size_t row = 0; row < height; ++row)
+    {
+        const size_t offset = (y + row) * m_width + x;
+        std::fill_n(m_pixels.begin() + offset, width, pixel);
+        std::fill_n(m_priority.begin() + offset, width, 0);
+    }
+}
+
+// Sets every pixel where the mask is non-zero to a single colour. Anything
+// outside the buffer is clipped.
+void ImageBuffer::InsertMask(int x, int y, const uint8_t* mask, size_t width, size_t height, size_t stride, uint8_t palette_index, uint8_t colour)
+{
+    const int col_begin = std::max(0, -x);
+    const int col_end = std::min(static_cast<int>(width), static_cast<int>(m_width) - x);
+    const int row_begin = std::max(0, -y);
+    const int row_end = std::min(static_cast<int>(height), static_cast<int>(m_height) - y);
+    const uint8_t pixel = (palette_index << 4) | (colour & 0x0F);
+    for (int row = row_begin; row < row_end; ++row)
+    {
+        const uint8_t* src = mask + row * stride;
+        const size_t offset = (y + row) * m_width + x;
+        for (int col = col_begin; col < col_end; ++col)
+        {
+            if (src[col] != 0)
+            {
+                m_pixels[offset + col] = pixel;
+                m_priority[offset + col] = 0;
+            }
+        }
+    }
+}
+
 const std::vector<uint8_t>& ImageBuffer::GetRGB(const std::vector<Palette>& pals) const
 {
 	m_rgb.resize(m_width * m_height * 3);
     auto it = m_rgb.begin();
 	for (const auto& pixel : m_pixels)
 	{
-        *it++ = (pals[pixel >> 4].getR(pixel & 0x0F));
-        *it++ = (pals[pixel >> 4].getG(pixel & 0x0F));
-        *it++ = (pals[pixel >> 4].getB(pixel & 0x0F));
+        const uint32_t rgba = pals[pixel >> 4].getRGBA(pixel & 0x0F);
+        *it++ = rgba & 0xFF;
+        *it++ = (rgba >> 8) & 0xFF;
+        *it++ = (rgba >> 16) & 0xFF;
 	}
 	return m_rgb;
 }
@@ -177,19 +428,6 @@ const std::vector<uint8_t>& ImageBuffer::GetAlpha(const std::vector<Palette>& pa
 	return m_alpha;
 }
 
-std::shared_ptr<wxBitmap> ImageBuffer::MakeBitmap(const std::vector<Palette>& pals, bool use_alpha, uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity) const
-{
-    GetRGB(pals);
-    wxImage img(m_width, m_height, m_rgb.data(), true);
-    if (use_alpha)
-    {
-        GetAlpha(pals, low_pri_max_opacity, high_pri_max_opacity);
-        img.SetAlpha(m_alpha.data(), true);
-    }
-    auto ret = std::make_shared<wxBitmap>(img);
-    return ret;
-}
-
 size_t ImageBuffer::GetHeight() const
 {
 	return m_height;
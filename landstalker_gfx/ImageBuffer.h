@@ -3,13 +3,15 @@
 
 #include <vector>
 #include <memory>
-#include <wx/image.h>
-#include <wx/bitmap.h>
+#include <string>
 
 #include "Tile.h"
 #include "Tileset.h"
 #include "Palette.h"
 #include "BigTile.h"
+#include "SpriteFrame.h"
+
+class SpriteTileStore;
 
 class ImageBuffer
 {
@@ -20,20 +22,28 @@ public:
 	void Resize(size_t width, size_t height);
 	void InsertTile(size_t x, size_t y, uint8_t palette_index, const Tile& tile, const Tileset& tileset);
 	bool WritePNG(const std::string& filename, const std::vector<Palette>& pals);
+	static bool WritePNG(const std::string& filename, const std::vector<uint8_t>& rgb, size_t width, size_t height);
 	void InsertBlock(size_t x, size_t y, uint8_t palette_index, const BigTile& block, const Tileset& tileset);
+	void InsertSprite(int x, int y, uint8_t palette_index, const SpriteFrame& frame, bool hflip = false, bool vflip = false);
+	void InsertSprite(int x, int y, uint8_t palette_index, const SpriteTileStore& tiles, size_t frame, bool hflip = false, bool vflip = false);
+	void Blit(size_t x, size_t y, const ImageBuffer& src, size_t src_x, size_t src_y, size_t width, size_t height);
+	void FillRect(size_t x, size_t y, size_t width, size_t height, uint8_t palette_index, uint8_t colour);
+	void InsertMask(int x, int y, const uint8_t* mask, size_t width, size_t height, size_t stride, uint8_t palette_index, uint8_t colour);
 	const std::vector<uint8_t>& GetRGB(const std::vector<Palette>& pals) const;
 	const std::vector<uint8_t>& GetAlpha(const std::vector<Palette>& pals, uint8_t low_pri_max_opacity = 0xFF, uint8_t high_pri_max_opacity = 0xFF) const;
-	std::shared_ptr<wxBitmap> MakeBitmap(const std::vector<Palette>& pals, bool use_alpha = false, uint8_t low_pri_max_opacity = 0xFF, uint8_t high_pri_max_opacity = 0xFF) const;
 	size_t GetHeight() const;
 	size_t GetWidth() const;
 private:
+	template <class TileSource>
+	void InsertSubSprites(int x, int y, uint8_t pal_bits, const std::vector<SpriteFrame::SubSprite>& subsprites, bool hflip, bool vflip, TileSource tile_source);
+	void InsertSpriteTile(int x, int y, uint8_t pal_bits, const uint8_t* pixels, bool hflip, bool vflip);
+
 	size_t m_width;
 	size_t m_height;
 	std::vector<uint8_t> m_pixels;
 	std::vector<uint8_t> m_priority;
 	mutable std::vector<uint8_t> m_rgb;
 	mutable std::vector<uint8_t> m_alpha;
-	mutable wxImage m_img;
 };
 
 #endif // IMAGE_BUFFER_H
@@ -32,6 +32,12 @@ uint16_t ilog2(uint16_t num)
 }
 
 uint16_t LSTilemapCmp::Decode(const uint8_t* src, RoomTilemap& tilemap)
+{
+    size_t esize = 0;
+    return Decode(src, tilemap, esize);
+}
+
+uint16_t LSTilemapCmp::Decode(const uint8_t* src, RoomTilemap& tilemap, size_t& esize)
 {
     BitBarrel bb(src);
     
@@ -179,5 +185,7 @@ uint16_t LSTilemapCmp::Decode(const uint8_t* src, RoomTilemap& tilemap)
             tilemap.heightmap[dst_addr++] = hm_pattern;
         }
     }
+    bb.advanceNextByte();
+    esize = bb.getBytePosition();
     return t;
 }
\ No newline at end of file
@@ -82,6 +82,7 @@ class LSTilemapCmp
 {
 public:
     static uint16_t Decode(const uint8_t* src, RoomTilemap& tilemap);
+    static uint16_t Decode(const uint8_t* src, RoomTilemap& tilemap, size_t& esize);
 private:
     LSTilemapCmp();
 };
@@ -2,7 +2,7 @@
 #include <cstring>
 #include <stdexcept>
 #include <sstream>
-#include <wx/wx.h>
+#include <cassert>
 
 #include "BitBarrel.h"
 
@@ -136,6 +136,11 @@ size_t LZ77::Encode(const uint8_t* inbuf, size_t bufsize, uint8_t* outbuf)
     {
         if(bb.full() || ((it == entries.end()) && !bb.empty()))
         {
+            // Flags are read MSB first, so a partial final byte is padded out
+            while(!bb.full())
+            {
+                bb(false);
+            }
             *outbuf++ = bb.out();
             esize++;
             for( ; bstart != it; ++bstart)
@@ -0,0 +1,59 @@
+#include "Log.h"
+#include "Utils.h"
+
+std::atomic<int> Log::s_level(LOG_COMPILE_LEVEL);
+std::atomic<uint32_t> Log::s_categories(Log::CAT_ALL);
+
+void Log::SetLevel(Level level)
+{
+	s_level.store(level, std::memory_order_relaxed);
+}
+
+void Log::SetCategories(uint32_t categories)
+{
+	s_categories.store(categories, std::memory_order_relaxed);
+}
+
+// Messages reach the sink as e.g. "[WARNING][SPRITE] message"
+void Log::Write(Category category, Level level, const std::string& message)
+{
+	Debug(std::string("[") + GetLevelName(level) + "][" + GetCategoryName(category) + "] " + message);
+}
+
+const char* Log::GetLevelName(Level level)
+{
+	switch (level)
+	{
+	case LEVEL_ERROR:
+		return "ERROR";
+	case LEVEL_WARNING:
+		return "WARNING";
+	case LEVEL_DEBUG:
+		return "DEBUG";
+	case LEVEL_TRACE:
+		return "TRACE";
+	default:
+		return "NONE";
+	}
+}
+
+const char* Log::GetCategoryName(Category category)
+{
+	switch (category)
+	{
+	case CAT_GENERAL:
+		return "GENERAL";
+	case CAT_SPRITE:
+		return "SPRITE";
+	case CAT_TILESET:
+		return "TILESET";
+	case CAT_IMAGE:
+		return "IMAGE";
+	case CAT_TILEMAP:
+		return "TILEMAP";
+	case CAT_ALL:
+		return "ALL";
+	default:
+		return "UNKNOWN";
+	}
+}
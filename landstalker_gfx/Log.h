@@ -0,0 +1,79 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+// Levels above LOG_COMPILE_LEVEL are removed at compile time, together with
+// the code that formats their messages. Override on the command line, e.g.
+// -DLOG_COMPILE_LEVEL=4 to keep trace output in a release build. Release
+// builds keep errors and warnings (LEVEL_WARNING).
+#ifndef LOG_COMPILE_LEVEL
+#if defined _DEBUG || defined DEBUG
+#define LOG_COMPILE_LEVEL 4
+#else
+#define LOG_COMPILE_LEVEL 2
+#endif
+#endif
+
+class Log
+{
+public:
+	enum Level
+	{
+		LEVEL_NONE = 0,
+		LEVEL_ERROR = 1,
+		LEVEL_WARNING = 2,
+		LEVEL_DEBUG = 3,
+		LEVEL_TRACE = 4
+	};
+
+	enum Category : uint32_t
+	{
+		CAT_GENERAL = 0x01,
+		CAT_SPRITE  = 0x02,
+		CAT_TILESET = 0x04,
+		CAT_IMAGE   = 0x08,
+		CAT_TILEMAP = 0x10,
+		CAT_ALL     = 0xFFFFFFFF
+	};
+
+	static bool IsEnabled(Category category, Level level)
+	{
+		return (static_cast<int>(level) <= s_level.load(std::memory_order_relaxed)) &&
+		       ((s_categories.load(std::memory_order_relaxed) & category) != 0);
+	}
+
+	static void SetLevel(Level level);
+	static void SetCategories(uint32_t categories);
+	static void Write(Category category, Level level, const std::string& message);
+	static const char* GetLevelName(Level level);
+	static const char* GetCategoryName(Category category);
+private:
+	Log();
+
+	static std::atomic<int> s_level;
+	static std::atomic<uint32_t> s_categories;
+};
+
+// The message expression is only evaluated, and the stream only built, once
+// both the compile-time level and the runtime level/category checks pass.
+#define LOG_AT(category, level, message)                                      \
+	do                                                                        \
+	{                                                                         \
+		if (((level) <= LOG_COMPILE_LEVEL) && Log::IsEnabled(category, level)) \
+		{                                                                     \
+			std::ostringstream log_ss_;                                       \
+			log_ss_ << message;                                               \
+			Log::Write(category, level, log_ss_.str());                       \
+		}                                                                     \
+	} while (0)
+
+#define LOG_ERROR(category, message)   LOG_AT(category, Log::LEVEL_ERROR, message)
+#define LOG_WARNING(category, message) LOG_AT(category, Log::LEVEL_WARNING, message)
+#define LOG_DEBUG(category, message)   LOG_AT(category, Log::LEVEL_DEBUG, message)
+#define LOG_TRACE(category, message)   LOG_AT(category, Log::LEVEL_TRACE, message)
+
+#endif // LOG_H
@@ -0,0 +1,133 @@
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// Thread-safe least-recently-used cache. Each entry is charged a cost when it
+// is inserted; once the total cost exceeds the budget the least recently used
+// entries are dropped. Values are handed out as shared pointers, so evicting
+// an entry never invalidates a value that a caller is still holding.
+template<class Key, class Value>
+class LruCache
+{
+public:
+	typedef std::shared_ptr<const Value> ValuePtr;
+
+	explicit LruCache(size_t budget)
+		: m_budget(budget), m_usage(0)
+	{
+	}
+
+	ValuePtr Find(const Key& key)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_index.find(key);
+		if (it == m_index.end())
+		{
+			return nullptr;
+		}
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+		return it->second->value;
+	}
+
+	void Insert(const Key& key, const ValuePtr& value, size_t cost = 1)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_index.find(key);
+		if (it != m_index.end())
+		{
+			m_usage -= it->second->cost;
+			m_entries.erase(it->second);
+			m_index.erase(it);
+		}
+		m_entries.push_front({ key, value, cost });
+		m_index[key] = m_entries.begin();
+		m_usage += cost;
+		Evict();
+	}
+
+	void Erase(const Key& key)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_index.find(key);
+		if (it != m_index.end())
+		{
+			m_usage -= it->second->cost;
+			m_entries.erase(it->second);
+			m_index.erase(it);
+		}
+	}
+
+	bool Contains(const Key& key) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_index.count(key) > 0;
+	}
+
+	void Clear()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_entries.clear();
+		m_index.clear();
+		m_usage = 0;
+	}
+
+	void SetBudget(size_t budget)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_budget = budget;
+		Evict();
+	}
+
+	size_t GetBudget() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_budget;
+	}
+
+	size_t GetUsage() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_usage;
+	}
+
+	size_t Size() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_entries.size();
+	}
+
+private:
+	struct Entry
+	{
+		Key key;
+		ValuePtr value;
+		size_t cost;
+	};
+
+	// Caller must hold m_mutex. The most recently inserted entry is always
+	// kept, even if it alone exceeds the budget.
+	void Evict()
+	{
+		while ((m_usage > m_budget) && (m_entries.size() > 1))
+		{
+			const Entry& victim = m_entries.back();
+			m_usage -= victim.cost;
+			m_index.erase(victim.key);
+			m_entries.pop_back();
+		}
+	}
+
+	size_t m_budget;
+	size_t m_usage;
+	std::list<Entry> m_entries;
+	std::map<Key, typename std::list<Entry>::iterator> m_index;
+	mutable std::mutex m_mutex;
+};
+
+#endif // LRU_CACHE_H
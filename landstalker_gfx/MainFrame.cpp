@@ -4,17 +4,14 @@
 #include <sstream>
 #include <cstring>
 #include <iomanip>
-#include <set>
+#include <algorithm>
 
 #include <wx/wx.h>
 #include <wx/aboutdlg.h>
 #include <wx/dcclient.h>
 #include <wx/msgdlg.h>
 #include <wx/colour.h>
-#include <wx/graphics.h>
 
-#include "LZ77.h"
-#include "BigTilesCmp.h"
 #include "LSTilemapCmp.h"
 #include "Rom.h"
 #include "ImageBuffer.h"
@@ -22,11 +19,17 @@
 #include "Utils.h"
 #include "Tilemap2D.h"
 #include "Blockmap2D.h"
+#include "WxAdapter.h"
+
+wxDEFINE_EVENT(EVT_ROM_LOAD_PROGRESS, wxThreadEvent);
 
 MainFrame::MainFrame(wxWindow* parent, const std::string& filename)
     : MainFrameBaseClass(parent),
-      m_gfxSize(0),
+      m_scaledBitmaps(MipPyramid::DEFAULT_BUDGET),
+      m_prefetcher(m_assets, m_workers),
       m_scale(1),
+      m_canvasScale(0),
+      m_zoom(MipPyramid::GetUnityZoom()),
       m_rpalidx(0),
       m_tsidx(0),
       m_bs1(0),
@@ -36,9 +39,22 @@ MainFrame::MainFrame(wxWindow* parent, const std::string& filename)
       m_sprite_anim(0),
       m_sprite_frame(0),
       m_mode(MODE_NONE),
-      m_layer_controls_enabled(false)
+      m_layer_controls_enabled(false),
+      m_loadGeneration(0),
+      m_loadedSections(0),
+      m_populatedSections(0),
+      m_spriteAtlasGfxIdx(-1),
+      m_spriteAnimTimer(this),
+      m_sprite_playing(false)
 {
     m_imgs = new ImgLst();
+    m_palette = std::make_shared<const std::vector<Palette>>(4);
+    m_tilemap = std::make_shared<RoomTilemap>();
+    Bind(wxEVT_TIMER, &MainFrame::OnSpriteAnimationTimer, this, m_spriteAnimTimer.GetId());
+    Bind(EVT_ROM_LOAD_PROGRESS, &MainFrame::OnRomLoadProgress, this);
+    m_browser->Bind(wxEVT_TREE_ITEM_EXPANDING, &MainFrame::OnBrowserExpanding, this);
+    // Every damaged pixel is painted, so erasing first would only flicker
+    m_scrollwindow->SetBackgroundStyle(wxBG_STYLE_PAINT);
     if (!filename.empty())
     {
         OpenRomFile(filename.c_str());
@@ -47,6 +63,17 @@ MainFrame::MainFrame(wxWindow* parent, const std::string& filename)
 
 MainFrame::~MainFrame()
 {
+    // Loader tasks post to this frame, so they must finish before it goes
+    ++m_loadGeneration;
+    m_prefetcher.Cancel();
+    try
+    {
+        m_workers.Wait();
+    }
+    catch (const std::exception&)
+    {
+    }
+    m_spriteAnimTimer.Stop();
     delete m_imgs;
 }
 
@@ -70,403 +97,615 @@ void MainFrame::OnAbout(wxCommandEvent& event)
 
 void MainFrame::OpenRomFile(const wxString& path)
 {
-    try
-    {
-        m_rom.load_from_file(static_cast<std::string>(path));
+    // Any load still in flight is for a ROM that is no longer wanted: its
+    // workers check the generation before each step, and results that are
+    // already queued are dropped when they arrive.
+    const unsigned generation = ++m_loadGeneration;
+    StopSpriteAnimation();
+    m_browser->DeleteAllItems();
+    m_spriteFrames.Clear();
+    m_spriteAtlas.Clear();
+    m_spriteAtlasGfxIdx = -1;
+    m_roomCache.Clear();
+    m_prefetcher.Cancel();
+    m_assets.Clear();
+    m_loadedSections = 0;
+    m_populatedSections = 0;
+    SetMode(MODE_NONE);
+    SetStatusText("Loading " + path + "...");
 
-        m_tilesetOffsets = m_rom.read_array<uint32_t>(0x44070, 31);
-        m_browser->DeleteAllItems();
-        m_browser->SetImageList(m_imgs);
-        wxTreeItemId nodeRoot = m_browser->AddRoot("");
-        wxTreeItemId nodeTs = m_browser->AppendItem(nodeRoot, "Tilesets", 1, 1, new TreeNodeData());
-        wxTreeItemId nodeATs = m_browser->AppendItem(nodeRoot, "Animated Tilesets", 1, 1, new TreeNodeData());
-        wxTreeItemId nodeBTs = m_browser->AppendItem(nodeRoot, "Big Tilesets", 3, 3, new TreeNodeData());
-        wxTreeItemId nodeRPal = m_browser->AppendItem(nodeRoot, "Room Palettes", 2, 2, new TreeNodeData());
-        wxTreeItemId nodeRm = m_browser->AppendItem(nodeRoot, "Rooms", 0, 0, new TreeNodeData());
-        wxTreeItemId nodeSprites = m_browser->AppendItem(nodeRoot, "Sprites", 4, 4, new TreeNodeData());
-
-        const uint32_t start_of_sprite_graphics = 0x120000;
-        const uint32_t start_of_sprite_table = start_of_sprite_graphics + 4;
-        const uint32_t start_of_anim_table = m_rom.read<uint32_t>(start_of_sprite_graphics);
-        const uint32_t start_of_frame_table = m_rom.read<uint32_t>(start_of_anim_table);
-        const uint32_t start_of_frames = m_rom.read<uint32_t>(start_of_frame_table);
-
-        std::set<uint32_t> frame_offsets;
-        for (uint32_t frame_offset = start_of_frame_table; frame_offset < start_of_frames; frame_offset += 4)
+    const std::string filename = static_cast<std::string>(path);
+    m_workers.Submit([this, filename, generation]()
+    {
+        auto load = std::make_shared<RomLoad>();
+        try
         {
-            frame_offsets.insert(m_rom.read<uint32_t>(frame_offset));
+            load->rom = std::make_shared<const Rom>(filename);
         }
-
-        std::vector<uint32_t> frames(frame_offsets.cbegin(), frame_offsets.cend());
-        std::map<uint32_t, uint32_t> frame_offset_to_frame_num;
-        for (size_t i = 0; i < frames.size(); ++i)
+        catch (const std::exception& e)
+        {
+            PostLoadEvent(generation, LOAD_FAILED, load, e.what());
+            return;
+        }
+        if (generation != m_loadGeneration)
         {
-            frame_offset_to_frame_num[frames[i]] = i;
-            m_spriteFrames.emplace_back(SpriteFrame(m_rom.data(frames[i])));
+            return;
         }
+        PostLoadEvent(generation, LOAD_ROM_READ, load);
 
-        std::vector<uint32_t> sprite_frames;
-        size_t i = 0;
-        for (uint32_t soffset = start_of_sprite_table; soffset < start_of_anim_table; soffset += 4)
+        // The table sections are independent, so each is parsed by whichever
+        // worker is free and handed to the frame as soon as it is done
+        for (int section = 0; section < RomTables::SECTION_COUNT; ++section)
         {
-            m_spriteGraphics.emplace_back(i++);
-            uint32_t start_anim_offset = m_rom.read<uint16_t>(soffset) * 4 + start_of_anim_table;
-            uint32_t end_anim_offset;
-            if (soffset + 4 >= start_of_anim_table)
-            {
-                end_anim_offset = start_of_frame_table;
-            }
-            else
+            m_workers.Submit([this, load, generation, section]()
             {
-                end_anim_offset = m_rom.read<uint16_t>(soffset + 4) * 4 + start_of_anim_table;
-            }
-            for (uint32_t aoffset = start_anim_offset; aoffset < end_anim_offset; aoffset += 4)
-            {
-                uint32_t start_frame_offset = m_rom.read<uint32_t>(aoffset);
-                uint32_t end_frame_offset;
-                if (aoffset + 4 >= start_of_frames)
+                if (generation != m_loadGeneration)
                 {
-                    end_frame_offset = start_of_frames;
+                    return;
                 }
-                else
+                try
                 {
-                    end_frame_offset = m_rom.read<uint32_t>(aoffset + 4);
+                    load->tables.Load(*load->rom, static_cast<RomTables::Section>(section));
                 }
-                std::vector<uint32_t> sframes = m_rom.read_array<uint32_t>(start_frame_offset, (end_frame_offset - start_frame_offset)/4);
-                for(auto& frame : sframes)
+                catch (const std::exception& e)
                 {
-                    frame = frame_offset_to_frame_num[frame];
+                    // A malformed ROM can fail with more than runtime_error
+                    // (e.g. bad_alloc from a corrupt length), and anything
+                    // left uncaught would be swallowed by the pool
+                    PostLoadEvent(generation, LOAD_FAILED, load, e.what());
+                    return;
                 }
-                m_spriteGraphics.back().AddAnimation(sframes);
-            }
+                PostLoadEvent(generation, section, load);
+            });
         }
+    });
+}
+
+// Called from worker threads: only the event queue is touched here.
+void MainFrame::PostLoadEvent(unsigned generation, int stage, const std::shared_ptr<RomLoad>& load, const std::string& message)
+{
+    wxThreadEvent* event = new wxThreadEvent(EVT_ROM_LOAD_PROGRESS);
+    event->SetInt(stage);
+    event->SetExtraLong(generation);
+    event->SetString(message);
+    event->SetPayload(load);
+    wxQueueEvent(this, event);
+}
 
-        for (size_t i = 0; i < (236 * 2); i+=2)
+void MainFrame::OnRomLoadProgress(wxThreadEvent& event)
+{
+    if (static_cast<unsigned>(event.GetExtraLong()) != m_loadGeneration)
+    {
+        // Left over from a load that has since been superseded
+        return;
+    }
+    auto load = event.GetPayload<std::shared_ptr<RomLoad>>();
+    switch (event.GetInt())
+    {
+    case LOAD_FAILED:
+        // Abandon the sections that are still running
+        ++m_loadGeneration;
+        m_browser->DeleteAllItems();
+        SetStatusText("");
+        wxMessageBox(event.GetString());
+        break;
+    case LOAD_ROM_READ:
+        // Shared with the loader and the asset cache rather than copied
+        m_rom = load->rom;
+        m_assets.Init(load->rom);
+        InitBrowser();
+        break;
+    case LOAD_SPRITE_TILES:
+        m_spriteFrames.SetSharedTiles(load->spriteTiles);
+        break;
+    default:
+        ApplySection(static_cast<RomTables::Section>(event.GetInt()), *load);
+        break;
+    }
+}
+
+void MainFrame::InitBrowser()
+{
+    m_browser->DeleteAllItems();
+    m_browser->SetImageList(m_imgs);
+    wxTreeItemId nodeRoot = m_browser->AddRoot("");
+    m_sectionNodes[RomTables::SECTION_TILESETS] = m_browser->AppendItem(nodeRoot, "Tilesets", 1, 1,
+        new TreeNodeData(TreeNodeData::NODE_SECTION, RomTables::SECTION_TILESETS));
+    m_browser->AppendItem(nodeRoot, "Animated Tilesets", 1, 1, new TreeNodeData());
+    m_sectionNodes[RomTables::SECTION_BIG_TILES] = m_browser->AppendItem(nodeRoot, "Big Tilesets", 3, 3,
+        new TreeNodeData(TreeNodeData::NODE_SECTION, RomTables::SECTION_BIG_TILES));
+    m_sectionNodes[RomTables::SECTION_ROOM_PALETTES] = m_browser->AppendItem(nodeRoot, "Room Palettes", 2, 2,
+        new TreeNodeData(TreeNodeData::NODE_SECTION, RomTables::SECTION_ROOM_PALETTES));
+    m_sectionNodes[RomTables::SECTION_ROOMS] = m_browser->AppendItem(nodeRoot, "Rooms", 0, 0,
+        new TreeNodeData(TreeNodeData::NODE_SECTION, RomTables::SECTION_ROOMS));
+    m_sectionNodes[RomTables::SECTION_SPRITES] = m_browser->AppendItem(nodeRoot, "Sprites", 4, 4,
+        new TreeNodeData(TreeNodeData::NODE_SECTION, RomTables::SECTION_SPRITES));
+
+    m_palette = std::make_shared<const std::vector<Palette>>(4);
+}
+
+void MainFrame::ApplySection(RomTables::Section section, RomLoad& load)
+{
+    RomTables& tables = load.tables;
+    // Each worker only writes its own section of the tables, so this
+    // section can be taken while the others are still being parsed
+    switch (section)
+    {
+    case RomTables::SECTION_TILESETS:
+        m_tilesetOffsets = std::move(tables.tilesetOffsets);
+        break;
+    case RomTables::SECTION_BIG_TILES:
+        m_bigTileTableOffsets = std::move(tables.bigTileTableOffsets);
+        m_bigTileOffsets = std::move(tables.bigTileOffsets);
+        break;
+    case RomTables::SECTION_ROOM_PALETTES:
+        m_pal2 = std::move(tables.roomPalettes);
+        if (!m_pal2.empty())
         {
-            uint8_t sprite_idx = m_rom.read<uint8_t>(0x1ABF2 + i + 1);
-            uint8_t sprite_gfx = m_rom.read<uint8_t>(0x1ABF2 + i);
-            m_sprites.emplace(sprite_idx, Sprite(sprite_gfx));
+            SetPalette(0, m_pal2[0]);
         }
+        break;
+    case RomTables::SECTION_ROOMS:
+        m_rooms = std::move(tables.rooms);
+        break;
+    case RomTables::SECTION_SPRITES:
+        // Frames are decoded when something needs them, on first use
+        m_spriteFrames.Init(*m_rom, tables.spriteFrameOffsets);
+        BuildSpriteTiles(tables.spriteFrameOffsets);
+        m_spriteGraphics = std::move(tables.spriteGraphics);
+        m_sprites = tables.sprites;
+        m_spriteIds = std::move(tables.spriteIds);
+        break;
+    default:
+        break;
+    }
+    m_loadedSections |= 1 << section;
+    PopulateSections();
+}
 
-        for (size_t offset = 0x1A453A; m_rom.read<uint8_t>(offset) != 0xFF; offset += 2)
+// Pools every sprite frame into one shared tile store, so atlases can be
+// packed without decoding frames. This is a nicety rather than something the
+// browser waits on, so it is one background task that gives way to a newer
+// ROM between frames. Until it arrives, atlases are built from the lazily
+// decoded frames instead.
+void MainFrame::BuildSpriteTiles(const std::vector<uint32_t>& offsets)
+{
+    const unsigned generation = m_loadGeneration;
+    auto load = std::make_shared<RomLoad>();
+    load->rom = m_rom;
+    m_workers.Submit([this, load, offsets, generation]()
+    {
+        SpriteFrameStore frames;
+        frames.Init(*load->rom, offsets);
+        try
         {
-            if ((m_rom.read<uint8_t>(offset + 1) & 0x80) > 0)
+            load->spriteTiles = frames.BuildSharedTiles([this, generation]()
             {
-                m_sprites[m_rom.read<uint8_t>(offset)].SetHighPalette(m_rom.read<uint8_t>(offset + 1) & 0x7F);
-            }
-            else
-            {
-                m_sprites[m_rom.read<uint8_t>(offset)].SetLowPalette(m_rom.read<uint8_t>(offset + 1));
-            }
+                return generation != m_loadGeneration;
+            });
+        }
+        catch (const std::exception&)
+        {
+            // Not fatal: atlases just keep using the decoded frames
+            return;
+        }
+        if (load->spriteTiles != nullptr)
+        {
+            PostLoadEvent(generation, LOAD_SPRITE_TILES, load);
         }
+    });
+}
 
-        for (const auto& sprite : m_sprites)
+void MainFrame::PopulateSections()
+{
+    // A section appears in the browser once everything its nodes need has
+    // loaded: a room can't be shown without its tileset and blocksets
+    static const uint32_t REQUIRES[RomTables::SECTION_COUNT] = {
+        0,
+        1 << RomTables::SECTION_TILESETS,
+        0,
+        (1 << RomTables::SECTION_TILESETS) | (1 << RomTables::SECTION_BIG_TILES) | (1 << RomTables::SECTION_ROOM_PALETTES),
+        0
+    };
+    size_t populated = 0;
+    for (int section = 0; section < RomTables::SECTION_COUNT; ++section)
+    {
+        const uint32_t bit = 1 << section;
+        if (((m_populatedSections & bit) == 0) && ((m_loadedSections & bit) != 0)
+            && ((m_loadedSections & REQUIRES[section]) == REQUIRES[section]))
+        {
+            PopulateSection(static_cast<RomTables::Section>(section));
+            m_populatedSections |= bit;
+        }
+        if ((m_populatedSections & bit) != 0)
         {
-            const auto& sg = m_spriteGraphics[sprite.second.GetGraphicsIdx()];
-            size_t default_anim = sg.GetAnimationCount() > 1 ? 1 : 0;
-            auto spr = m_browser->AppendItem(nodeSprites, Hex(sprite.first), 4, 4, new TreeNodeData(TreeNodeData::NODE_SPRITE, default_anim << 16 | sprite.first));
+            populated++;
+        }
+    }
+    if (populated == RomTables::SECTION_COUNT)
+    {
+        SetStatusText("");
+    }
+    else
+    {
+        std::ostringstream ss;
+        ss << "Loading... " << populated << " of " << static_cast<int>(RomTables::SECTION_COUNT) << " sections ready";
+        SetStatusText(ss.str());
+    }
+}
 
-            for (size_t a = 0; a != sg.GetAnimationCount(); ++a)
+void MainFrame::PopulateSection(RomTables::Section section)
+{
+    // Only the section node itself is touched here. Its children are created
+    // when it is first expanded, so nothing is built for parts of the ROM
+    // that are never browsed.
+    m_browser->SetItemHasChildren(m_sectionNodes[section], true);
+}
+
+void MainFrame::OnBrowserExpanding(wxTreeEvent& event)
+{
+    const wxTreeItemId item = event.GetItem();
+    if (item.IsOk() && (m_browser->GetChildrenCount(item, false) == 0))
+    {
+        PopulateChildren(item);
+    }
+    event.Skip();
+}
+
+void MainFrame::PopulateChildren(const wxTreeItemId& node)
+{
+    const TreeNodeData* itemData = static_cast<TreeNodeData*>(m_browser->GetItemData(node));
+    if (itemData == nullptr)
+    {
+        return;
+    }
+    const size_t value = itemData->GetValue();
+    switch (itemData->GetNodeType())
+    {
+    case TreeNodeData::NODE_SECTION:
+        switch (value)
+        {
+        case RomTables::SECTION_TILESETS:
+            for (size_t i = 0; i < m_tilesetOffsets.size(); ++i)
+            {
+                m_browser->AppendItem(node, Hex(m_tilesetOffsets[i]), 1, 1, new TreeNodeData(TreeNodeData::NODE_TILESET, i));
+            }
+            break;
+        case RomTables::SECTION_BIG_TILES:
+            for (size_t i = 0; i < m_bigTileOffsets.size(); ++i)
+            {
+                wxTreeItemId curTn = m_browser->AppendItem(node, Hex(m_bigTileTableOffsets[i]), 3, 3, new TreeNodeData(TreeNodeData::NODE_BIG_TILES, i << 16));
+                m_browser->SetItemHasChildren(curTn, !m_bigTileOffsets[i].empty());
+            }
+            break;
+        case RomTables::SECTION_ROOM_PALETTES:
+            InitPals(node);
+            break;
+        case RomTables::SECTION_ROOMS:
+            for (size_t i = 0; i < m_rooms.size(); i++)
             {
                 std::ostringstream ss;
-                ss.str(std::string());
-                ss << "ANIM" << a;
-                wxTreeItemId anim = m_browser->AppendItem(spr, ss.str(), 4, 4, new TreeNodeData(TreeNodeData::NODE_SPRITE, a << 16 | sprite.first));
-                for (size_t f = 0; f != sg.GetFrameCount(a); ++f)
-                {
-                    ss.str(std::string());
-                    ss << "FRAME" << f;
-                    m_browser->AppendItem(anim, ss.str(), 4, 4, new TreeNodeData(TreeNodeData::NODE_SPRITE, a << 16 | f << 8 | sprite.first));
-                }
+                ss << i;
+                wxTreeItemId cRm = m_browser->AppendItem(node, ss.str(), 0, 0, new TreeNodeData(TreeNodeData::NODE_ROOM, i));
+                m_browser->SetItemHasChildren(cRm, true);
+            }
+            break;
+        case RomTables::SECTION_SPRITES:
+            for (uint8_t sprite_id : m_spriteIds)
+            {
+                const auto& sg = m_spriteGraphics[m_sprites[sprite_id].GetGraphicsIdx()];
+                size_t default_anim = sg.GetAnimationCount() > 1 ? 1 : 0;
+                auto spr = m_browser->AppendItem(node, Hex(sprite_id), 4, 4, new TreeNodeData(TreeNodeData::NODE_SPRITE, default_anim << 16 | sprite_id));
+                m_browser->SetItemHasChildren(spr, sg.GetAnimationCount() > 0);
             }
+            break;
+        default:
+            break;
         }
-
-        for (size_t i = 0; i < m_tilesetOffsets.size(); ++i)
+        break;
+    case TreeNodeData::NODE_BIG_TILES:
+    {
+        // Only the top-level blockset nodes are expandable
+        const size_t i = value >> 16;
+        for (size_t j = 0; j < m_bigTileOffsets[i].size(); ++j)
         {
-            m_browser->AppendItem(nodeTs, Hex(m_tilesetOffsets[i]), 1, 1, new TreeNodeData(TreeNodeData::NODE_TILESET, i));
+            m_browser->AppendItem(node, Hex(m_bigTileOffsets[i][j]), 3, 3, new TreeNodeData(TreeNodeData::NODE_BIG_TILES, i << 16 | j));
         }
-        auto bt = m_rom.read_array<uint32_t>(m_rom.read<uint32_t>(0x1AF800), 64);
-        for (size_t i = 0; i < 64; ++i)
+        break;
+    }
+    case TreeNodeData::NODE_ROOM:
+        m_browser->AppendItem(node, "Heightmap", 0, 0, new TreeNodeData(TreeNodeData::NODE_ROOM_HEIGHTMAP, value));
+        break;
+    case TreeNodeData::NODE_SPRITE:
+    {
+        // Sprite nodes hold their animations, and animation nodes their frames
+        const uint8_t sprite_id = value & 0xFF;
+        const auto& sg = m_spriteGraphics[m_sprites[sprite_id].GetGraphicsIdx()];
+        std::ostringstream ss;
+        if (m_browser->GetItemParent(node) == m_sectionNodes[RomTables::SECTION_SPRITES])
         {
-            m_bigTileOffsets.push_back(m_rom.read_array<uint32_t>(bt[i], 9));
-            wxTreeItemId curTn = m_browser->AppendItem(nodeBTs, Hex(bt[i]), 3, 3, new TreeNodeData(TreeNodeData::NODE_BIG_TILES, i << 16));
-            for (size_t j = 0; j < 9; ++j)
+            for (size_t a = 0; a != sg.GetAnimationCount(); ++a)
             {
-                m_browser->AppendItem(curTn, Hex(m_bigTileOffsets[i][j]), 3, 3, new TreeNodeData(TreeNodeData::NODE_BIG_TILES, i << 16 | j));
+                ss.str(std::string());
+                ss << "ANIM" << a;
+                wxTreeItemId anim = m_browser->AppendItem(node, ss.str(), 4, 4, new TreeNodeData(TreeNodeData::NODE_SPRITE, a << 16 | sprite_id));
+                m_browser->SetItemHasChildren(anim, sg.GetFrameCount(a) > 0);
             }
         }
-        const uint8_t* rm = m_rom.data(m_rom.read<uint32_t>(0xA0A00));
-        for (size_t i = 0; i < 816; i++)
+        else
         {
-            std::ostringstream ss;
-            m_rooms.push_back(RoomData(rm));
-            rm += 8;
-            ss << i;
-            wxTreeItemId cRm = m_browser->AppendItem(nodeRm, ss.str(), 0, 0, new TreeNodeData(TreeNodeData::NODE_ROOM, i));
-            m_browser->AppendItem(cRm, "Heightmap", 0, 0, new TreeNodeData(TreeNodeData::NODE_ROOM_HEIGHTMAP, i));
+            const size_t a = (value >> 16) & 0xFF;
+            for (size_t f = 0; f != sg.GetFrameCount(a); ++f)
+            {
+                ss.str(std::string());
+                ss << "FRAME" << f;
+                m_browser->AppendItem(node, ss.str(), 4, 4, new TreeNodeData(TreeNodeData::NODE_SPRITE_FRAME, a << 16 | f << 8 | sprite_id));
+            }
         }
-        InitPals(nodeRPal);
+        break;
     }
-    catch(const std::runtime_error& e)
-    {
-        m_browser->DeleteAllItems();
-        wxMessageBox(e.what());
+    default:
+        break;
     }
-    SetMode(MODE_NONE);
 }
 
 void MainFrame::DrawBigTiles(size_t row_width, size_t scale, uint8_t pal)
 {
-    const size_t ROW_WIDTH = std::min<size_t>(16U, m_bigTiles.size());
-    const size_t ROW_HEIGHT = std::min<size_t>(128U, m_bigTiles.size() / ROW_WIDTH + (m_bigTiles.size() % ROW_WIDTH != 0));
+    const size_t ROW_WIDTH = std::min<size_t>(16U, m_blockset->size());
+    const size_t ROW_HEIGHT = std::min<size_t>(128U, m_blockset->size() / ROW_WIDTH + (m_blockset->size() % ROW_WIDTH != 0));
     Blockmap2D map(ROW_WIDTH, ROW_HEIGHT, 0, 0, 0);
     m_imgbuf.Resize(map.GetBitmapWidth(), map.GetBitmapHeight());
-    map.SetTileset(std::make_shared<Tileset>(m_tilebmps));
-    map.SetBlockset(std::make_shared<std::vector<BigTile>>(m_bigTiles));
+    map.SetTileset(m_tileset);
+    map.SetBlockset(m_blockset);
     map.Fill(0, 1);
     map.Draw(m_imgbuf);
     m_scale = scale;
-    bmp = m_imgbuf.MakeBitmap(m_palette);
+    bmp = MakeBitmap(m_imgbuf, *m_palette);
     ForceRepaint();
 }
 
-void DrawTile(wxGraphicsContext& gc, int x, int y, int z, int width, int height, int restrictions, int classification)
+void MainFrame::DrawTilemap(size_t scale, uint8_t pal)
 {
-    wxPoint2DDouble tile_points[] = {
-        wxPoint2DDouble(x + width / 2, y             ),
-        wxPoint2DDouble(x + width    , y + height / 2),
-        wxPoint2DDouble(x + width / 2, y + height    ),
-        wxPoint2DDouble(x            , y + height / 2),
-        wxPoint2DDouble(x + width / 2, y             )
-    };
-    wxPoint2DDouble left_wall[] = {
-        wxPoint2DDouble(x            , y + height / 2             ),
-        wxPoint2DDouble(x + width / 2, y + height                 ),
-        wxPoint2DDouble(x + width / 2, y + height     + z * height),
-        wxPoint2DDouble(x            , y + height / 2 + z * height),
-        wxPoint2DDouble(x            , y + height / 2             )
-    };
-    wxPoint2DDouble right_wall[] = {
-        wxPoint2DDouble(x + width / 2, y + height                 ),
-        wxPoint2DDouble(x + width    , y + height / 2             ),
-        wxPoint2DDouble(x + width    , y + height / 2 + z * height),
-        wxPoint2DDouble(x + width / 2, y + height     + z * height),
-        wxPoint2DDouble(x + width / 2, y + height                 )
-    };
-    wxColor bg;
-    if (restrictions == 0)
-    {
-        bg.Set(z * 3, 48 + z * 8, z*3);
-    }
-    else if (restrictions == 0x4)
+    // Layers are only drawn when the room or palette changes; opacity and
+    // visibility changes just blend the cached layers again
+    if (!m_roomCache.IsValid(m_roomnum, pal))
     {
-        bg.Set(48 + z * 8, z*3, z*3);
-    }
-    else if (restrictions == 0x2)
-    {
-        bg.Set(32 + z * 3, 32 + z * 3, 48 + z * 12);
-    }
-    else if (restrictions == 0x6)
-    {
-        bg.Set(48 + z * 8, 32 + z * 3, 48 + z * 8);
-    }
-    else
-    {
-        bg.Set(48 + z * 8, 48 + z * 8, z * 3);
-    }
-    gc.SetBrush(wxBrush(bg));
-    gc.SetPen(*wxTRANSPARENT_PEN);
-    //gc.SetTextForeground(*wxWHITE);
-    gc.DrawLines(sizeof(tile_points) / sizeof(tile_points[0]), tile_points);
-    bg = bg.ChangeLightness(70);
-    gc.SetBrush(wxBrush(bg));
-    gc.DrawLines(sizeof(left_wall) / sizeof(left_wall[0]), left_wall);
-    bg = bg.ChangeLightness(70);
-    gc.SetBrush(wxBrush(bg));
-    gc.DrawLines(sizeof(right_wall) / sizeof(right_wall[0]), right_wall);
-    if (classification != 0)
-    {
-        // Set font and transparent colour
-        gc.SetFont(wxFont(height/2, wxFONTFAMILY_DEFAULT, wxFONTSTYLE_NORMAL,
-           wxFONTWEIGHT_NORMAL, false),
-           wxColour(255, 255, 255, 255));
-        std::ostringstream ss;
-        ss << std::hex << std::setw(2) << std::setfill('0') << std::uppercase << classification;
-        double textwidth, textheight;
-        gc.GetTextExtent(ss.str(), &textwidth, &textheight);
-        gc.DrawText(ss.str(), x + (width - textwidth)/2, y + (height - textheight)/2 );
+        RenderRoomLayers(pal);
     }
+    m_scale = scale;
+    CompositeRoom();
 }
 
-void SetOpacity(wxImage& image, uint8_t opacity)
+void MainFrame::RenderRoomLayers(uint8_t pal)
 {
-    uint8_t* alpha = image.GetAlpha();
-    for (int i = 0; i < (image.GetHeight() * image.GetWidth()); i++)
-    {
-        *alpha = (*alpha < opacity) ? *alpha : opacity;
-        alpha++;
-    }
+    const size_t width = m_tilemap->background.GetBitmapWidth();
+    const size_t height = m_tilemap->background.GetBitmapHeight();
+
+    m_roomCache.Begin(m_roomnum, pal, width, height);
+    m_imgbuf.Resize(width, height);
+    ImageBuffer fg(width, height);
+    m_tilemap->background.SetTileset(m_tileset);
+    m_tilemap->foreground.SetTileset(m_tileset);
+    m_tilemap->background.SetBlockset(m_blockset);
+    m_tilemap->foreground.SetBlockset(m_blockset);
+    m_tilemap->background.Draw(m_imgbuf);
+    m_tilemap->foreground.Draw(fg);
+    m_roomCache.SetLayer(RoomRenderCache::LAYER_BACKGROUND, m_imgbuf, *m_palette);
+    m_roomCache.SetLayer(RoomRenderCache::LAYER_FOREGROUND, fg, *m_palette);
+
+    std::vector<uint8_t> hm_rgba;
+    m_heightmapOverlay.Draw(*m_tilemap, hm_rgba);
+    m_roomCache.SetLayer(RoomRenderCache::LAYER_HEIGHTMAP, hm_rgba);
 }
 
-void MainFrame::DrawTilemap(size_t scale, uint8_t pal)
+void MainFrame::CompositeRoom()
 {
-    const size_t TILE_WIDTH = 32;
-    const size_t TILE_HEIGHT = 16;
-
-    uint8_t bg_opacity  = m_checkBgVisible->GetValue() ? m_sliderBgOpacity->GetValue() : 0;
-    uint8_t fg1_opacity = m_checkFg1Visible->GetValue() ? m_sliderFg1Opacity->GetValue() : 0;
-    uint8_t fg2_opacity = m_checkFg2Visible->GetValue() ? m_sliderFg2Opacity->GetValue() : 0;
-    uint8_t hm_opacity  = m_checkHeightmapVisible->GetValue() ? m_sliderHeightmapOpacity->GetValue() : 0;
-    uint8_t spr_opacity = m_checkSpritesVisible->GetValue() ? m_sliderSpritesOpacity->GetValue() : 0;
-
-    m_imgbuf.Resize(m_tilemap.background.GetBitmapWidth(), m_tilemap.background.GetBitmapHeight());
-    ImageBuffer fg(m_tilemap.background.GetBitmapWidth(), m_tilemap.background.GetBitmapHeight());
-    m_tilemap.background.SetTileset(std::make_shared<Tileset>(m_tilebmps));
-    m_tilemap.foreground.SetTileset(std::make_shared<Tileset>(m_tilebmps));
-    m_tilemap.background.SetBlockset(std::make_shared<std::vector<BigTile>>(m_bigTiles));
-    m_tilemap.foreground.SetBlockset(std::make_shared<std::vector<BigTile>>(m_bigTiles));
-    m_tilemap.background.Draw(m_imgbuf);
-    m_tilemap.foreground.Draw(fg);
-    m_scale = scale;
-    std::shared_ptr<wxBitmap> bg_bmp(m_imgbuf.MakeBitmap(m_palette, true, bg_opacity));
-    std::shared_ptr<wxBitmap> fg_bmp(fg.MakeBitmap(m_palette, true, fg1_opacity, fg2_opacity));
-    wxImage hm_img(fg.GetWidth(), fg.GetHeight());
-    wxImage disp_img(fg.GetWidth(), fg.GetHeight());
-    hm_img.InitAlpha();
-    SetOpacity(hm_img, 0x00);
-    wxGraphicsContext* hm_gc = wxGraphicsContext::Create(hm_img);
-    hm_gc->SetPen(*wxWHITE_PEN);
-    hm_gc->SetBrush(*wxBLACK_BRUSH);
-    size_t p = 0;
-    for (size_t y = 0; y < m_tilemap.hmheight; ++y)
-        for (size_t x = 0; x < m_tilemap.hmwidth; ++x)
-        {
-            // Only display cells that are not completely restricted
-            if ((m_tilemap.heightmap[p].height > 0) || (m_tilemap.heightmap[p].restrictions != 0x04))
-            {
-                size_t xx = x - m_tilemap.GetLeft() + 12;
-                size_t yy = y - m_tilemap.GetTop() + 12;
-                size_t zz = m_tilemap.heightmap[p].height;
-                wxPoint xy(m_tilemap.foreground.ToXYPoint3D(TilePoint3D{ xx, yy, zz }));
-                DrawTile(*hm_gc, xy.x, xy.y, zz, TILE_WIDTH, TILE_HEIGHT, m_tilemap.heightmap[p].restrictions, m_tilemap.heightmap[p].classification);
-            }
-            p++;
-        }
-    delete hm_gc;
-    SetOpacity(hm_img, hm_opacity);
-    wxBitmap hm_bmp(hm_img);
-    //hm_bmp.UseAlpha();
-    wxGraphicsContext* disp_gc = wxGraphicsContext::Create(disp_img);
-    disp_gc->DrawBitmap(*bg_bmp, 0, 0, bg_bmp->GetWidth(), bg_bmp->GetHeight());
-    disp_gc->DrawBitmap(*fg_bmp, 0, 0, fg_bmp->GetWidth(), fg_bmp->GetHeight());
-    disp_gc->DrawBitmap(hm_bmp, 0, 0, hm_bmp.GetWidth(), hm_bmp.GetHeight());
-    delete disp_gc;
-    bmp = std::make_shared<wxBitmap>(disp_img);
-    memDc.SelectObject(*bmp);
+    std::array<RoomRenderCache::LayerOpacity, RoomRenderCache::LAYER_COUNT> opacity;
+    const uint8_t bg_opacity = m_checkBgVisible->GetValue() ? m_sliderBgOpacity->GetValue() : 0;
+    const uint8_t hm_opacity = m_checkHeightmapVisible->GetValue() ? m_sliderHeightmapOpacity->GetValue() : 0;
+    opacity[RoomRenderCache::LAYER_BACKGROUND].low = bg_opacity;
+    opacity[RoomRenderCache::LAYER_BACKGROUND].high = bg_opacity;
+    opacity[RoomRenderCache::LAYER_FOREGROUND].low = m_checkFg1Visible->GetValue() ? m_sliderFg1Opacity->GetValue() : 0;
+    opacity[RoomRenderCache::LAYER_FOREGROUND].high = m_checkFg2Visible->GetValue() ? m_sliderFg2Opacity->GetValue() : 0;
+    opacity[RoomRenderCache::LAYER_HEIGHTMAP].low = hm_opacity;
+    opacity[RoomRenderCache::LAYER_HEIGHTMAP].high = hm_opacity;
+
+    bmp = MakeBitmap(m_roomCache.Composite(opacity), m_roomCache.GetWidth(), m_roomCache.GetHeight());
     ForceRepaint();
 }
 
 void MainFrame::DrawHeightmap(size_t scale, uint16_t room)
 {
-    const size_t TILE_WIDTH = 32;
-    const size_t TILE_HEIGHT = 32;
-    const size_t ROW_WIDTH = m_tilemap.hmwidth;
-    const size_t ROW_HEIGHT = m_tilemap.hmheight;
-    const size_t BMP_WIDTH = ROW_WIDTH * TILE_WIDTH + 1;
-    const size_t BMP_HEIGHT = ROW_HEIGHT * TILE_WIDTH + 1;
-
-    //size_t x = 0;
-    //size_t y = 0;
-    bmp = std::make_shared<wxBitmap>(BMP_WIDTH, BMP_HEIGHT);
-    memDc.SelectObject(*bmp);
-    memDc.SetBackground(*wxBLACK_BRUSH);
-    memDc.Clear();
-    memDc.SetPen(*wxWHITE_PEN);
-    memDc.SetBrush(*wxBLACK_BRUSH);
-    memDc.SetTextBackground(*wxBLACK);
-    memDc.SetTextForeground(*wxWHITE);
-
-    size_t p = 0;
-    for(size_t y = 0; y < ROW_HEIGHT; ++y)
-    for(size_t x = 0; x < ROW_WIDTH; ++x)
-    {
-        // Only display cells that are not completely restricted
-        if((m_tilemap.heightmap[p].height > 0) || (m_tilemap.heightmap[p].restrictions != 0x04))
-        {
-            wxPoint xy(m_tilemap.foreground.ToXYPoint(TilePoint{ x, y }));
-            memDc.DrawRectangle(x * TILE_WIDTH, y*TILE_HEIGHT, TILE_WIDTH+1, TILE_HEIGHT+1);
-            std::stringstream ss;
-            ss << std::hex << std::uppercase << std::setfill('0') << std::setw(1) << static_cast<unsigned>(m_tilemap.heightmap[p].height) << ","
-            << std::setfill('0') << std::setw(1) << static_cast<unsigned>(m_tilemap.heightmap[p].restrictions) << "\n"
-            << std::setfill('0') << std::setw(2) << static_cast<unsigned>(m_tilemap.heightmap[p].classification);
-            memDc.DrawText(ss.str(),x*TILE_WIDTH+2, y*TILE_HEIGHT + 1);
-        }
-        p++;
-    }
-    memDc.SelectObject(wxNullBitmap);
-
+    m_heightmapView.Draw(*m_tilemap, m_imgbuf);
     m_scale = scale;
-    m_scrollwindow->SetScrollbars(scale,scale,BMP_WIDTH,BMP_HEIGHT,0,0);
-    wxClientDC dc(m_scrollwindow);
-    dc.SetBackground(*wxBLACK_BRUSH);
-    dc.Clear();
-    PaintNow(dc, scale);
+    bmp = MakeBitmap(m_imgbuf, m_heightmapView.GetPalettes());
+    ForceRepaint();
 }
 
 void MainFrame::DrawTiles(size_t row_width, size_t scale, uint8_t pal)
 {
-    const size_t ROW_WIDTH = std::min<size_t>(16UL, m_tilebmps.size());
-    const size_t ROW_HEIGHT = std::min<size_t>(128UL, m_tilebmps.size() / ROW_WIDTH + (m_tilebmps.size() % ROW_WIDTH != 0));
+    const size_t ROW_WIDTH = std::min<size_t>(16UL, m_tileset->size());
+    const size_t ROW_HEIGHT = std::min<size_t>(128UL, m_tileset->size() / ROW_WIDTH + (m_tileset->size() % ROW_WIDTH != 0));
     Tilemap2D map(ROW_WIDTH, ROW_HEIGHT, 0, 0, 0);
     m_imgbuf.Resize(map.GetBitmapWidth(), map.GetBitmapHeight());
-    map.SetTileset(std::make_shared<Tileset>(m_tilebmps));
+    map.SetTileset(m_tileset);
     map.Fill(0, 1);
     map.Draw(m_imgbuf);
     m_scale = scale;
-    bmp = m_imgbuf.MakeBitmap(m_palette);
+    bmp = MakeBitmap(m_imgbuf, *m_palette);
     ForceRepaint();
 }
 
-void MainFrame::DrawSprite(const SpriteFrame& sprite, uint8_t pal_idx, size_t scale)
+void MainFrame::BuildSpriteAtlas(const SpriteGraphic& sprite_gfx, uint8_t pal_idx)
 {
-    size_t top = 0xFFFF;
-    size_t left = 0xFFFF;
-    size_t bottom = 0;
-    size_t right = 0;
+    // Every frame of every animation is packed once, so switching frames
+    // afterwards is just a copy out of the atlas
+    std::vector<size_t> ids;
+    for (size_t a = 0; a < sprite_gfx.GetAnimationCount(); ++a)
+    {
+        for (size_t f = 0; f < sprite_gfx.GetFrameCount(a); ++f)
+        {
+            ids.push_back(sprite_gfx.RetrieveFrameIdx(a, f));
+        }
+    }
+    auto tiles = m_spriteFrames.GetSharedTiles();
+    if (tiles != nullptr)
+    {
+        m_spriteAtlas.Build(ids, *tiles, pal_idx);
+    }
+    else
+    {
+        std::map<size_t, std::shared_ptr<const SpriteFrame>> frames;
+        for (size_t frame : ids)
+        {
+            if (frames.count(frame) == 0)
+            {
+                frames[frame] = m_spriteFrames.Get(frame);
+            }
+        }
+        m_spriteAtlas.Build(frames, pal_idx);
+    }
+    m_spriteAtlasGfxIdx = sprite_gfx.GetIndex();
+}
+
+void MainFrame::DrawSprite(size_t frame, size_t scale)
+{
+    const SpriteAtlas::Entry& entry = m_spriteAtlas.GetEntry(frame);
+    m_imgbuf.Resize(entry.width, entry.height);
+    m_spriteAtlas.Draw(frame, m_imgbuf, 0, 0);
+    m_scale = scale;
+    bmp = MakeBitmap(m_imgbuf, *m_palette);
+    ForceRepaint();
+}
 
-    for (const auto& subs : sprite.m_subsprites)
+void MainFrame::StartSpriteAnimation(const SpriteGraphic& sprite_gfx, size_t anim, size_t scale)
+{
+    // All frames share one canvas covering the union of their bounds, so the
+    // sprite stays anchored to its origin as the frames change size
+    int left = 0x7FFF;
+    int top = 0x7FFF;
+    int right = -0x7FFF;
+    int bottom = -0x7FFF;
+    std::vector<size_t> frames;
+    for (size_t f = 0; f < sprite_gfx.GetFrameCount(anim); ++f)
+    {
+        frames.push_back(sprite_gfx.RetrieveFrameIdx(anim, f));
+        const SpriteAtlas::Entry& entry = m_spriteAtlas.GetEntry(frames.back());
+        left   = std::min(left,   entry.origin_x);
+        top    = std::min(top,    entry.origin_y);
+        right  = std::max(right,  entry.origin_x + static_cast<int>(entry.width));
+        bottom = std::max(bottom, entry.origin_y + static_cast<int>(entry.height));
+    }
+    if (frames.empty())
     {
-        left   = std::min(left,    (subs.x + 0x80) & 0xFF);
-        top    = std::min(top,     (subs.y + 0x80) & 0xFF);
-        right  = std::max(right,  ((subs.x + 0x80) & 0xFF) + subs.w * 8);
-        bottom = std::max(bottom, ((subs.y + 0x80) & 0xFF) + subs.h * 8);
+        // Nothing to play, so blank the canvas rather than leave the
+        // previous selection showing
+        bmp = std::make_shared<wxBitmap>(1, 1);
+        memDc.SelectObject(*bmp);
+        memDc.SetBackground(*wxBLACK_BRUSH);
+        memDc.Clear();
+        memDc.SelectObject(wxNullBitmap);
+        ForceRepaint();
+        return;
     }
 
+    // Each frame is rendered to a bitmap once; playback just swaps bitmaps
     m_imgbuf.Resize(right - left, bottom - top);
-
-    for (const auto& subs : sprite.m_subsprites)
+    m_spriteAnimBitmaps.clear();
+    for (size_t frame : frames)
     {
-        size_t index = subs.tile_idx;
-        for (size_t x = 0; x < subs.w; ++x)
-        for (size_t y = 0; y < subs.h; ++y)
-        {
-            size_t xx = ((subs.x + 0x80) & 0xFF) - left + x * 8;
-            size_t yy = ((subs.y + 0x80) & 0xFF) - top + y * 8;
-            m_imgbuf.InsertTile(xx, yy, pal_idx, Tile(index++), sprite.m_sprite_gfx);
-        }
+        const SpriteAtlas::Entry& entry = m_spriteAtlas.GetEntry(frame);
+        m_imgbuf.Clear();
+        m_spriteAtlas.Draw(frame, m_imgbuf, entry.origin_x - left, entry.origin_y - top);
+        m_spriteAnimBitmaps.push_back(MakeBitmap(m_imgbuf, *m_palette));
     }
+    m_spriteAnimator.Start(frames.size());
     m_scale = scale;
-    bmp = m_imgbuf.MakeBitmap(m_palette);
+    bmp = m_spriteAnimBitmaps.front();
     ForceRepaint();
+    if (m_spriteAnimator.IsRunning())
+    {
+        m_spriteAnimTimer.Start(1000 / SpriteAnimator::GAME_FRAME_RATE);
+    }
+}
+
+void MainFrame::StopSpriteAnimation()
+{
+    m_spriteAnimTimer.Stop();
+    m_spriteAnimator.Stop();
+    m_spriteAnimBitmaps.clear();
 }
 
+void MainFrame::OnSpriteAnimationTimer(wxTimerEvent& event)
+{
+    if (m_spriteAnimator.Update())
+    {
+        bmp = m_spriteAnimBitmaps[m_spriteAnimator.GetCurrentIndex()];
+        // Only the sprite's own rectangle needs repainting
+        const wxRect sprite_rect(m_scrollwindow->CalcScrolledPosition(wxPoint(0, 0)), m_canvasSize);
+        m_scrollwindow->RefreshRect(sprite_rect, false);
+    }
+}
+
+// Called whenever the displayed image changes. The user's zoom is kept
+// unless the view asks for a different default scale (m_scale), and the
+// new image is simply painted over the old one.
 void MainFrame::ForceRepaint()
 {
-    m_scrollwindow->SetScrollbars(m_scale, m_scale, m_imgbuf.GetWidth(), m_imgbuf.GetHeight(), 0, 0);
-    wxClientDC dc(m_scrollwindow);
-    dc.SetBackground(*wxBLACK_BRUSH);
-    dc.Clear();
-    PaintNow(dc, m_scale);
+    m_scaledBitmaps.Clear();
+    m_pyramid.Clear();
+    if (m_scale != m_canvasScale)
+    {
+        m_canvasScale = m_scale;
+        m_zoom = MipPyramid::FindZoom(m_scale);
+    }
+    if (bmp != nullptr)
+    {
+        m_zoom = std::min(m_zoom, MipPyramid::FindLargestZoom(bmp->GetWidth(), bmp->GetHeight(), m_pyramid.GetBudget()));
+    }
+    ResizeCanvas(wxPoint(0, 0));
+}
+
+// Sizes the canvas to the image at the current zoom. The view only moves if
+// the size actually changes, in which case it scrolls to the given position
+// on the new canvas; otherwise it keeps its scroll position.
+void MainFrame::ResizeCanvas(const wxPoint& view)
+{
+    wxSize size(0, 0);
+    if (bmp != nullptr)
+    {
+        const auto level_size = MipPyramid::GetLevelSize(bmp->GetWidth(), bmp->GetHeight(), m_zoom);
+        size = wxSize(level_size.first, level_size.second);
+    }
+    if (size != m_canvasSize)
+    {
+        m_canvasSize = size;
+        m_scrollwindow->SetScrollbars(SCROLL_UNIT, SCROLL_UNIT,
+            (size.GetWidth() + SCROLL_UNIT - 1) / SCROLL_UNIT, (size.GetHeight() + SCROLL_UNIT - 1) / SCROLL_UNIT,
+            std::max(view.x, 0) / SCROLL_UNIT, std::max(view.y, 0) / SCROLL_UNIT, true);
+    }
+    m_scrollwindow->Refresh(false);
+}
+
+// Zooms about a point in the window, keeping the image under it still. The
+// zoom stops where a single level of the image would exceed the budget.
+void MainFrame::SetZoom(size_t zoom, const wxPoint& anchor)
+{
+    if (bmp == nullptr)
+    {
+        return;
+    }
+    zoom = std::min(zoom, MipPyramid::FindLargestZoom(bmp->GetWidth(), bmp->GetHeight(), m_pyramid.GetBudget()));
+    if (zoom == m_zoom)
+    {
+        return;
+    }
+    const wxPoint canvas_anchor(m_scrollwindow->CalcUnscrolledPosition(anchor));
+    const double ratio = MipPyramid::GetScale(zoom) / MipPyramid::GetScale(m_zoom);
+    m_zoom = zoom;
+    m_scaledBitmaps.Clear();
+    ResizeCanvas(wxPoint(static_cast<int>(canvas_anchor.x * ratio) - anchor.x,
+                         static_cast<int>(canvas_anchor.y * ratio) - anchor.y));
 }
 
 void MainFrame::OnPaint(wxPaintEvent& event)
@@ -474,65 +713,104 @@ void MainFrame::OnPaint(wxPaintEvent& event)
     event.Skip();
 }
 
-void MainFrame::PaintNow(wxDC& dc, size_t scale)
+// Repaints only the damaged parts of the window: whatever overlaps the image
+// is copied from its pre-scaled bitmap, and the rest is filled with black.
+void MainFrame::PaintNow(wxDC& dc, const wxRegion& damaged)
 {
-    int x, y, w, h;
-    m_scrollwindow->GetViewStart(&x, &y);
-    m_scrollwindow->GetClientSize(&w, &h);
-    double dscale = static_cast<double>(scale);
+    wxRect image_rect;
+    // Held for the whole paint, as the cache may drop it at any time
+    std::shared_ptr<const wxBitmap> scaled;
     memDc.SelectObject(wxNullBitmap);
     if (bmp != nullptr)
     {
-        memDc.SelectObject(*bmp);
+        scaled = GetScaledBitmap();
+        memDc.SelectObjectAsSource(*scaled);
+        image_rect = wxRect(m_scrollwindow->CalcScrolledPosition(wxPoint(0, 0)), scaled->GetSize());
+    }
+    dc.SetPen(*wxTRANSPARENT_PEN);
+    dc.SetBrush(*wxBLACK_BRUSH);
+    for (wxRegionIterator it(damaged); it; ++it)
+    {
+        const wxRect rect(it.GetRect());
+        const wxRect visible(rect.Intersect(image_rect));
+        if (!visible.IsEmpty())
+        {
+            const wxPoint src(m_scrollwindow->CalcUnscrolledPosition(visible.GetTopLeft()));
+            dc.Blit(visible.GetTopLeft(), visible.GetSize(), &memDc, src);
+        }
+        wxRegion background(rect);
+        background.Subtract(visible);
+        for (wxRegionIterator bg(background); bg; ++bg)
+        {
+            dc.DrawRectangle(bg.GetRect());
+        }
     }
-    dc.SetUserScale(dscale, dscale);
-    dc.Blit(0, 0, w/dscale+1, h/dscale+1, &memDc, x, y, wxCOPY, true);
     memDc.SelectObject(wxNullBitmap);
 }
 
-void MainFrame::OnScrollWindowPaint(wxPaintEvent& event)
+// The current image at the current zoom. Zoomed pixels come from the mip
+// pyramid, so zooming never redraws the image itself, and a bitmap of each
+// source is kept for the current zoom, within the budget, so repaints and
+// scrolling are plain blits and animation frames are usually only converted
+// the first time round.
+std::shared_ptr<const wxBitmap> MainFrame::GetScaledBitmap()
 {
-    wxPaintDC dc(m_scrollwindow);
-    PaintNow(dc, m_scale);
-    event.Skip();
+    if (m_zoom == MipPyramid::GetUnityZoom())
+    {
+        return bmp;
+    }
+    auto entry = m_scaledBitmaps.Find(bmp.get());
+    if (entry == nullptr)
+    {
+        // Both caches are emptied whenever the image changes, so a bitmap's
+        // address identifies it for as long as it can be displayed
+        const size_t id = reinterpret_cast<size_t>(bmp.get());
+        if (!m_pyramid.HasImage(id))
+        {
+            const wxImage img(bmp->ConvertToImage());
+            m_pyramid.SetImage(id, img.GetData(), img.GetWidth(), img.GetHeight());
+        }
+        auto level = m_pyramid.GetLevel(id, m_zoom);
+        auto scaled = std::make_shared<ScaledBitmap>();
+        scaled->source = bmp;
+        scaled->scaled = MakeBitmap(level->rgb, level->width, level->height);
+        m_scaledBitmaps.Insert(bmp.get(), scaled, level->rgb.size());
+        return scaled->scaled;
+    }
+    return entry->scaled;
 }
 
-void MainFrame::LoadTileset(size_t offset)
+void MainFrame::OnScrollWindowPaint(wxPaintEvent& event)
 {
-    std::memset(m_gfxBuffer, 0x00, sizeof(m_gfxBuffer));
-    size_t elen = 0;
-    m_gfxSize = LZ77::Decode(m_rom.data(offset), sizeof(m_gfxBuffer), m_gfxBuffer, elen);
-    m_tilebmps.setBits(m_gfxBuffer, 0x400);
+    wxPaintDC dc(m_scrollwindow);
+    PaintNow(dc, m_scrollwindow->GetUpdateRegion());
+    event.Skip();
 }
 
-void MainFrame::LoadBigTiles(size_t offset)
+// Palette sets may still be shared with earlier renders, so changing an
+// entry makes a new set rather than altering the existing one
+void MainFrame::SetPalette(size_t index, const Palette& pal)
 {
-    BigTilesCmp::Decode(m_rom.data(offset), m_bigTiles);
+    auto pals = std::make_shared<std::vector<Palette>>(*m_palette);
+    (*pals)[index] = pal;
+    m_palette = pals;
 }
 
 void MainFrame::LoadTilemap(size_t offset)
 {
-    LSTilemapCmp::Decode(m_rom.data(offset), m_tilemap);
+    // The cached map is shared, and rendering attaches the current tileset
+    // and blockset to it, so the room gets its own (cheap) copy
+    m_tilemap = std::make_shared<RoomTilemap>(*m_assets.GetRoomMap(offset));
 }
 
 void MainFrame::InitPals(const wxTreeItemId& node)
 {
-    const uint8_t* const base_pal = m_rom.data(m_rom.read<uint32_t>(0xA0A04));
-    const uint8_t* pal = base_pal;
-    for(size_t i = 0; i < 54; ++i)
+    for(size_t i = 0; i < m_pal2.size(); ++i)
     {
-        m_pal2.push_back(Palette(pal, i, Palette::ROOM_PALETTE));
-
         std::ostringstream ss;
         ss << std::dec << std::setw(2) << std::setfill('0') << i;
         m_browser->AppendItem(node, ss.str(), 2, 2, new TreeNodeData(TreeNodeData::NODE_ROOM_PAL, i));
     }
-
-    m_palette.clear();
-    m_palette.emplace_back(m_pal2[0]);
-    m_palette.emplace_back();
-    m_palette.emplace_back();
-    m_palette.emplace_back();
 }
 void MainFrame::OnExport(wxCommandEvent& event)
 {
@@ -543,7 +821,9 @@ void MainFrame::OnExport(wxCommandEvent& event)
 
         if (fdlog.ShowModal() == wxID_OK)
         {
-            m_imgbuf.WritePNG(std::string(fdlog.GetPath()), m_palette);
+            // The heightmap is drawn with its own palettes, not the room's
+            const std::vector<Palette>& pals = (m_mode == MODE_HEIGHTMAP) ? m_heightmapView.GetPalettes() : *m_palette;
+            m_imgbuf.WritePNG(std::string(fdlog.GetPath()), pals);
         }
     }
     event.Skip();
@@ -564,13 +844,13 @@ void MainFrame::InitRoom(uint16_t room)
     m_roomnum = room;
     const RoomData& rd = m_rooms[m_roomnum];
     m_rpalidx = rd.roomPalette;
-    m_palette[0] = m_pal2[m_rpalidx];
+    SetPalette(0, m_pal2[m_rpalidx]);
     m_tsidx = rd.tileset;
-    LoadTileset(m_tilesetOffsets[m_tsidx]);
-    m_bigTiles.clear();
-    LoadBigTiles(m_bigTileOffsets[rd.bigTilesetIdx][0]);
-    LoadBigTiles(m_bigTileOffsets[rd.bigTilesetIdx][1 + rd.secBigTileset]);
+    m_tileset = m_assets.GetTileset(m_tilesetOffsets[m_tsidx]);
+    m_blockset = m_assets.GetBlockset(m_bigTileOffsets[rd.bigTilesetIdx][0], m_bigTileOffsets[rd.bigTilesetIdx][1 + rd.secBigTileset]);
     LoadTilemap(rd.offset);
+    // The next room is most likely a neighbour of this one
+    m_prefetcher.Start(m_roomnum, m_rooms, m_tilesetOffsets, m_bigTileOffsets);
 }
 
 void MainFrame::PopulateRoomProperties(uint16_t room, const RoomTilemap& tm)
@@ -685,22 +965,19 @@ void MainFrame::SetMode(const Mode& mode)
 
 void MainFrame::Refresh()
 {
+    StopSpriteAnimation();
     switch (m_mode)
     {
     case MODE_TILESET:
         // Display tileset
         EnableLayerControls(false);
-        LoadTileset(m_tilesetOffsets[m_tsidx]);
+        m_tileset = m_assets.GetTileset(m_tilesetOffsets[m_tsidx]);
         DrawTiles(16, 2, m_rpalidx);
         break;
     case MODE_BLOCKSET:
         EnableLayerControls(false);
-        LoadTileset(m_tilesetOffsets[m_tsidx]);
-        LoadBigTiles(m_bigTileOffsets[m_bs2][0]);
-        if (m_bs2 > 0)
-        {
-            LoadBigTiles(m_bigTileOffsets[m_bs1][m_bs2]);
-        }
+        m_tileset = m_assets.GetTileset(m_tilesetOffsets[m_tsidx]);
+        m_blockset = m_assets.GetBlockset(m_bigTileOffsets[m_bs1][0], (m_bs2 > 0) ? m_bigTileOffsets[m_bs1][m_bs2] : 0);
         DrawBigTiles(16, 1, m_rpalidx);
         // Display blockset
         break;
@@ -712,18 +989,39 @@ void MainFrame::Refresh()
         // Display room map
         EnableLayerControls(true);
         InitRoom(m_roomnum);
-        PopulateRoomProperties(m_roomnum, m_tilemap);
+        PopulateRoomProperties(m_roomnum, *m_tilemap);
+        // The room has just been decoded again, and other modes may have
+        // reused the image buffer, so the layers are drawn afresh here. The
+        // layer controls go straight to DrawTilemap and reuse them.
+        m_roomCache.Clear();
         DrawTilemap(m_scale, m_rpalidx);
         break;
+    case MODE_HEIGHTMAP:
+        // Display heightmap, which has no layers of its own
+        EnableLayerControls(false);
+        InitRoom(m_roomnum);
+        PopulateRoomProperties(m_roomnum, *m_tilemap);
+        DrawHeightmap(1, m_roomnum);
+        break;
     case MODE_SPRITE:
     {
         // Display sprite
         EnableLayerControls(false);
         const auto& sprite = m_sprites[m_sprite_idx];
         const auto& sprite_gfx = m_spriteGraphics[sprite.GetGraphicsIdx()];
-        uint32_t frame = sprite_gfx.RetrieveFrameIdx(m_sprite_anim, m_sprite_frame);
-        m_palette[1] = sprite.GetPalette(m_rom.data(0x1A4BA0), m_rom.data(0x1A47E0));
-        DrawSprite(m_spriteFrames[frame], 1, 4);
+        SetPalette(1, sprite.GetPalette(m_rom->data(RomTables::SPRITE_HIGH_PALETTES), m_rom->data(RomTables::SPRITE_LOW_PALETTES)));
+        if (m_spriteAtlasGfxIdx != sprite_gfx.GetIndex())
+        {
+            BuildSpriteAtlas(sprite_gfx, 1);
+        }
+        if (m_sprite_playing)
+        {
+            StartSpriteAnimation(sprite_gfx, m_sprite_anim, 4);
+        }
+        else
+        {
+            DrawSprite(sprite_gfx.RetrieveFrameIdx(m_sprite_anim, m_sprite_frame), 4);
+        }
         break;
     }
     case MODE_NONE:
@@ -743,6 +1041,7 @@ void MainFrame::Refresh()
 void MainFrame::OnBrowserSelect(wxTreeEvent& event)
 {
     TreeNodeData* itemData = static_cast<TreeNodeData*>(m_browser->GetItemData(event.GetItem()));
+    m_prefetcher.Cancel();
     m_properties->GetGrid()->Clear();
     switch (itemData->GetNodeType())
     {
@@ -762,7 +1061,7 @@ void MainFrame::OnBrowserSelect(wxTreeEvent& event)
     case TreeNodeData::NODE_ROOM_PAL:
     {
         m_rpalidx = itemData->GetValue();
-        m_palette[0] = m_pal2[m_rpalidx];
+        SetPalette(0, m_pal2[m_rpalidx]);
         Refresh();
         break;
     }
@@ -771,17 +1070,18 @@ void MainFrame::OnBrowserSelect(wxTreeEvent& event)
         SetMode(MODE_ROOMMAP);
         break;
     case TreeNodeData::NODE_ROOM_HEIGHTMAP:
-        InitRoom(itemData->GetValue());
-        PopulateRoomProperties(m_roomnum, m_tilemap);
-        DrawHeightmap(1, m_roomnum);
+        m_roomnum = itemData->GetValue();
+        SetMode(MODE_HEIGHTMAP);
         break;
     case TreeNodeData::NODE_SPRITE:
+    case TreeNodeData::NODE_SPRITE_FRAME:
     {
-        Palette pal;
+        // Sprite and animation nodes play the animation, frame nodes show a still
         uint32_t data = itemData->GetValue();
         m_sprite_idx = data & 0xFF;
         m_sprite_anim = (data >> 16) & 0xFF;
         m_sprite_frame = (data >> 8) & 0xFF;
+        m_sprite_playing = (itemData->GetNodeType() == TreeNodeData::NODE_SPRITE);
         SetMode(MODE_SPRITE);
         break;
     }
@@ -862,7 +1162,19 @@ void MainFrame::OnScrollWindowLeftUp(wxMouseEvent& event)
 }
 void MainFrame::OnScrollWindowMousewheel(wxMouseEvent& event)
 {
-    event.Skip();
+    // Ctrl+wheel zooms about the pointer; the plain wheel still scrolls
+    if (!event.ControlDown() || (event.GetWheelRotation() == 0))
+    {
+        event.Skip();
+    }
+    else if (event.GetWheelRotation() > 0)
+    {
+        SetZoom(m_zoom + 1, event.GetPosition());
+    }
+    else if (m_zoom > 0)
+    {
+        SetZoom(m_zoom - 1, event.GetPosition());
+    }
 }
 void MainFrame::OnScrollWindowMouseMove(wxMouseEvent& event)
 {
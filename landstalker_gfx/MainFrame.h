@@ -3,8 +3,12 @@
 #include "wxcrafter.h"
 #include <cstdint>
 #include <vector>
+#include <array>
 #include <memory>
+#include <atomic>
+#include <map>
 #include <wx/dcmemory.h>
+#include <wx/timer.h>
 #include "BigTile.h"
 #include "Tileset.h"
 #include "Palette.h"
@@ -12,8 +16,21 @@
 #include "Rom.h"
 #include "SpriteGraphic.h"
 #include "SpriteFrame.h"
+#include "SpriteFrameStore.h"
+#include "SpriteAtlas.h"
+#include "SpriteTileStore.h"
+#include "SpriteAnimator.h"
 #include "Sprite.h"
 #include "ImageBuffer.h"
+#include "RomTables.h"
+#include "RoomRenderCache.h"
+#include "HeightmapOverlay.h"
+#include "HeightmapView.h"
+#include "MipPyramid.h"
+#include "LruCache.h"
+#include "AssetCache.h"
+#include "RoomPrefetcher.h"
+#include "ThreadPool.h"
 
 #ifdef _WIN32
 #include <winsock.h>
@@ -23,6 +40,9 @@
 
 class wxImage;
 
+// Posted by the background ROM loader as each stage completes
+wxDECLARE_EVENT(EVT_ROM_LOAD_PROGRESS, wxThreadEvent);
+
 class MainFrame : public MainFrameBaseClass
 {
 public:
@@ -62,38 +82,32 @@ protected:
     virtual void OnScrollWindowKeyDown(wxKeyEvent& event);
     virtual void OnScrollWindowKeyUp(wxKeyEvent& event);
 private:
-    struct RoomData
-    {
-        uint32_t offset;
-        uint8_t tileset;
-        uint8_t priBigTileset;
-        uint8_t secBigTileset;
-        uint8_t bigTilesetIdx;
-        uint8_t roomPalette;
-        uint8_t backgroundMusic;
-        uint8_t unknownParam1;
-        uint8_t unknownParam2;
-        uint8_t unknownParam3;
+    typedef RomTables::RoomData RoomData;
 
-        RoomData(const uint8_t* src)
-        :   offset((src[0] << 24) | (src[1] << 16) | (src[2] << 8) | src[3]),
-            tileset(src[4] & 0x1F),
-            priBigTileset((src[4] >> 5) & 0x01),
-            secBigTileset((src[7] >> 5) & 0x07),
-            bigTilesetIdx(priBigTileset << 5 | tileset),
-            roomPalette(src[5] & 0x3F),
-            backgroundMusic(src[7] & 0x1F),
-            unknownParam1((src[4] >> 6) & 0x03),
-            unknownParam2((src[5] >> 6) & 0x03),
-            unknownParam3(src[6])
-        {
-        }
+    // Canvas scroll step, in displayed pixels
+    static const int SCROLL_UNIT = 8;
+
+    // Everything the background loader produces for one ROM. The workers
+    // share it; each section is only written by the worker that parses it.
+    struct RomLoad
+    {
+        std::shared_ptr<const Rom> rom;
+        RomTables tables;
+        std::shared_ptr<const SpriteTileStore> spriteTiles;
+    };
+    enum LoadStage
+    {
+        LOAD_SPRITE_TILES = -3,
+        LOAD_FAILED = -2,
+        LOAD_ROM_READ = -1
+        // Values from zero are the RomTables section that has finished
     };
     class TreeNodeData : public wxTreeItemData
     {
     public:
         enum NodeType {
             NODE_BASE,
+            NODE_SECTION,
             NODE_TILESET,
             NODE_ANIM_TILESET,
             NODE_BIG_TILES,
@@ -117,39 +131,75 @@ private:
         MODE_BLOCKSET,
         MODE_PALETTE,
         MODE_ROOMMAP,
+        MODE_HEIGHTMAP,
         MODE_SPRITE
     };
     void DrawTiles(size_t row_width = -1, size_t scale = 1, uint8_t pal = 0);
     void DrawBigTiles(size_t row_width = -1, size_t scale = 1, uint8_t pal = 0);
     void DrawTilemap(size_t scale, uint8_t pal);
+    void RenderRoomLayers(uint8_t pal);
+    void CompositeRoom();
     void DrawHeightmap(size_t scale, uint16_t room);
-    void DrawSprite(const SpriteFrame& sprite, uint8_t pal_idx, size_t scale = 4);
+    void DrawSprite(size_t frame, size_t scale = 4);
+    void BuildSpriteAtlas(const SpriteGraphic& sprite_gfx, uint8_t pal_idx);
+    void StartSpriteAnimation(const SpriteGraphic& sprite_gfx, size_t anim, size_t scale = 4);
+    void StopSpriteAnimation();
+    void OnSpriteAnimationTimer(wxTimerEvent& event);
     void ForceRepaint();
-    void PaintNow(wxDC& dc, size_t scale = 1);
+    void PaintNow(wxDC& dc, const wxRegion& damaged);
+    std::shared_ptr<const wxBitmap> GetScaledBitmap();
+    void ResizeCanvas(const wxPoint& view);
+    void SetZoom(size_t zoom, const wxPoint& anchor);
     void InitPals(const wxTreeItemId& node);
-    void LoadTileset(size_t offset);
     void LoadTilemap(size_t offset);
-    void LoadBigTiles(size_t offset);
+    void SetPalette(size_t index, const Palette& pal);
     void OpenRomFile(const wxString& path);
+    void PostLoadEvent(unsigned generation, int stage, const std::shared_ptr<RomLoad>& load, const std::string& message = "");
+    void OnRomLoadProgress(wxThreadEvent& event);
+    void InitBrowser();
+    void ApplySection(RomTables::Section section, RomLoad& load);
+    void BuildSpriteTiles(const std::vector<uint32_t>& offsets);
+    void PopulateSections();
+    void PopulateSection(RomTables::Section section);
+    void OnBrowserExpanding(wxTreeEvent& event);
+    void PopulateChildren(const wxTreeItemId& node);
     void InitRoom(uint16_t room);
     void PopulateRoomProperties(uint16_t room, const RoomTilemap& tm);
     void EnableLayerControls(bool state);
     void SetMode(const Mode& mode);
     void Refresh();
     
-    RoomTilemap m_tilemap;
-    Rom m_rom;
-    uint8_t m_gfxBuffer[65536];
-    size_t m_gfxSize;
+    std::shared_ptr<RoomTilemap> m_tilemap;
+    std::shared_ptr<const Rom> m_rom;
     wxMemoryDC memDc;
     std::shared_ptr<wxBitmap> bmp;
+    struct ScaledBitmap
+    {
+        std::shared_ptr<wxBitmap> source;
+        std::shared_ptr<wxBitmap> scaled;
+    };
+    // Charged against a budget the size of the pyramid's. The pyramid only
+    // caches levels below 1x, so these are the only copy of levels above.
+    LruCache<const wxBitmap*, ScaledBitmap> m_scaledBitmaps;
+    MipPyramid m_pyramid;
     std::vector<RoomData> m_rooms;
     std::vector<Palette> m_pal2;
-    std::vector<Palette> m_palette;
-    Tileset m_tilebmps;
+    // Assets are immutable once loaded and shared by handle, so renders
+    // never copy them and can safely run on other threads
+    std::shared_ptr<const std::vector<Palette>> m_palette;
+    std::shared_ptr<const Tileset> m_tileset;
+    std::shared_ptr<const std::vector<BigTile>> m_blockset;
     ImageBuffer m_imgbuf;
+    RoomRenderCache m_roomCache;
+    HeightmapOverlay m_heightmapOverlay;
+    HeightmapView m_heightmapView;
+    AssetCache m_assets;
+    RoomPrefetcher m_prefetcher;
     wxImage m_img;
     size_t m_scale;
+    size_t m_canvasScale;
+    size_t m_zoom;
+    wxSize m_canvasSize;
     uint8_t m_rpalidx;
     uint8_t m_tsidx;
     uint8_t m_bs1;
@@ -160,13 +210,25 @@ private:
     uint16_t m_sprite_frame;
     Mode m_mode;
     bool m_layer_controls_enabled;
+    std::atomic<unsigned> m_loadGeneration;
+    uint32_t m_loadedSections;
+    uint32_t m_populatedSections;
+    std::array<wxTreeItemId, RomTables::SECTION_COUNT> m_sectionNodes;
     std::vector<uint32_t> m_tilesetOffsets;
+    std::vector<uint32_t> m_bigTileTableOffsets;
     std::vector<std::vector<uint32_t>> m_bigTileOffsets;
-    std::vector<BigTile> m_bigTiles;
-    std::vector<SpriteFrame> m_spriteFrames;
+    SpriteFrameStore m_spriteFrames;
+    SpriteAtlas m_spriteAtlas;
+    size_t m_spriteAtlasGfxIdx;
+    wxTimer m_spriteAnimTimer;
+    SpriteAnimator m_spriteAnimator;
+    std::vector<std::shared_ptr<wxBitmap>> m_spriteAnimBitmaps;
+    bool m_sprite_playing;
     std::vector<SpriteGraphic> m_spriteGraphics;
-    std::map<uint8_t, Sprite> m_sprites;
+    std::array<Sprite, 256> m_sprites;
+    std::vector<uint8_t> m_spriteIds;
     uint16_t m_pal[54][15];
     ImgLst* m_imgs;
+    ThreadPool m_workers;
 };
 #endif // MAINFRAME_H
@@ -0,0 +1,220 @@
+#include "MipPyramid.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+// Each zoom level is a scale of numerator / denominator. The steps below 1x
+// must each be half of the next, as each is filtered down from that one.
+struct ZoomStep
+{
+	size_t numerator;
+	size_t denominator;
+};
+
+const ZoomStep ZOOM_STEPS[] = {
+	{ 1, 8 }, { 1, 4 }, { 1, 2 }, { 1, 1 }, { 2, 1 }, { 3, 1 }, { 4, 1 }, { 6, 1 }, { 8, 1 }
+};
+const size_t ZOOM_COUNT = sizeof(ZOOM_STEPS) / sizeof(ZOOM_STEPS[0]);
+const size_t UNITY_ZOOM = 3;
+}
+
+MipPyramid::MipPyramid(size_t budget)
+	: m_levels(budget)
+{
+}
+
+// Adds an image, or replaces it if the id is already in use
+void MipPyramid::SetImage(size_t id, const uint8_t* rgb, size_t width, size_t height)
+{
+	auto source = std::make_shared<Level>();
+	source->width = width;
+	source->height = height;
+	source->rgb.assign(rgb, rgb + width * height * 3);
+	m_sources[id] = source;
+	for (size_t zoom = 0; zoom < ZOOM_COUNT; ++zoom)
+	{
+		m_levels.Erase(std::make_pair(id, zoom));
+	}
+}
+
+bool MipPyramid::HasImage(size_t id) const
+{
+	return m_sources.count(id) > 0;
+}
+
+void MipPyramid::Clear()
+{
+	m_sources.clear();
+	m_levels.Clear();
+}
+
+std::shared_ptr<const MipPyramid::Level> MipPyramid::GetLevel(size_t id, size_t zoom)
+{
+	auto source = m_sources.find(id);
+	if ((source == m_sources.end()) || (zoom >= ZOOM_COUNT))
+	{
+		throw std::runtime_error("Attempt to obtain a missing mip level");
+	}
+	if (zoom == UNITY_ZOOM)
+	{
+		return source->second;
+	}
+	if (GetLevelCost(source->second->width, source->second->height, zoom) > m_levels.GetBudget())
+	{
+		throw std::runtime_error("Attempt to obtain a mip level larger than the memory budget");
+	}
+	if (zoom > UNITY_ZOOM)
+	{
+		return Upscale(*source->second, ZOOM_STEPS[zoom].numerator);
+	}
+	const auto key = std::make_pair(id, zoom);
+	auto level = m_levels.Find(key);
+	if (level == nullptr)
+	{
+		level = Downscale(*GetLevel(id, zoom + 1));
+		m_levels.Insert(key, level, level->rgb.size());
+	}
+	return level;
+}
+
+void MipPyramid::SetBudget(size_t budget)
+{
+	m_levels.SetBudget(budget);
+}
+
+size_t MipPyramid::GetBudget() const
+{
+	return m_levels.GetBudget();
+}
+
+size_t MipPyramid::GetUsage() const
+{
+	return m_levels.GetUsage();
+}
+
+size_t MipPyramid::GetZoomCount()
+{
+	return ZOOM_COUNT;
+}
+
+size_t MipPyramid::GetUnityZoom()
+{
+	return UNITY_ZOOM;
+}
+
+// The largest zoom level that does not exceed the given integer scale
+size_t MipPyramid::FindZoom(size_t scale)
+{
+	size_t zoom = UNITY_ZOOM;
+	while ((zoom + 1 < ZOOM_COUNT) && (ZOOM_STEPS[zoom + 1].numerator <= scale))
+	{
+		++zoom;
+	}
+	return zoom;
+}
+
+double MipPyramid::GetScale(size_t zoom)
+{
+	const ZoomStep& step = ZOOM_STEPS[std::min(zoom, ZOOM_COUNT - 1)];
+	return static_cast<double>(step.numerator) / step.denominator;
+}
+
+// Halving rounds up, so a level always covers the whole image
+std::pair<size_t, size_t> MipPyramid::GetLevelSize(size_t width, size_t height, size_t zoom)
+{
+	zoom = std::min(zoom, ZOOM_COUNT - 1);
+	if (zoom >= UNITY_ZOOM)
+	{
+		return std::make_pair(width * ZOOM_STEPS[zoom].numerator, height * ZOOM_STEPS[zoom].numerator);
+	}
+	for (size_t z = UNITY_ZOOM; z > zoom; --z)
+	{
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+	}
+	return std::make_pair(width, height);
+}
+
+// Bytes of RGB data in a level
+size_t MipPyramid::GetLevelCost(size_t width, size_t height, size_t zoom)
+{
+	const auto size = GetLevelSize(width, height, zoom);
+	return size.first * size.second * 3;
+}
+
+// The largest zoom whose level fits within the budget. The source image is
+// always available, so this is never below 1x.
+size_t MipPyramid::FindLargestZoom(size_t width, size_t height, size_t budget)
+{
+	size_t zoom = UNITY_ZOOM;
+	while ((zoom + 1 < ZOOM_COUNT) && (GetLevelCost(width, height, zoom + 1) <= budget))
+	{
+		++zoom;
+	}
+	return zoom;
+}
+
+std::shared_ptr<const MipPyramid::Level> MipPyramid::Upscale(const Level& src, size_t factor)
+{
+	auto level = std::make_shared<Level>();
+	level->width = src.width * factor;
+	level->height = src.height * factor;
+	level->rgb.resize(level->width * level->height * 3);
+	auto dest = level->rgb.begin();
+	for (size_t y = 0; y < src.height; ++y)
+	{
+		// Build one scaled row, then repeat it for the remaining rows
+		const auto row_begin = dest;
+		auto in = src.rgb.cbegin() + y * src.width * 3;
+		for (size_t x = 0; x < src.width; ++x, in += 3)
+		{
+			for (size_t i = 0; i < factor; ++i)
+			{
+				dest = std::copy(in, in + 3, dest);
+			}
+		}
+		for (size_t i = 1; i < factor; ++i)
+		{
+			dest = std::copy(row_begin, row_begin + level->width * 3, dest);
+		}
+	}
+	return level;
+}
+
+// Each output pixel averages the 2x2 block it covers. Blocks on an odd
+// right or bottom edge average just the pixels that exist.
+std::shared_ptr<const MipPyramid::Level> MipPyramid::Downscale(const Level& src)
+{
+	auto level = std::make_shared<Level>();
+	level->width = (src.width + 1) / 2;
+	level->height = (src.height + 1) / 2;
+	level->rgb.resize(level->width * level->height * 3);
+	auto dest = level->rgb.begin();
+	for (size_t y = 0; y < level->height; ++y)
+	{
+		const size_t y0 = y * 2;
+		const size_t y1 = std::min(y0 + 1, src.height - 1);
+		for (size_t x = 0; x < level->width; ++x)
+		{
+			const size_t x0 = x * 2;
+			const size_t x1 = std::min(x0 + 1, src.width - 1);
+			const size_t count = (1 + (x1 != x0)) * (1 + (y1 != y0));
+			const uint8_t* p[4] = {
+				&src.rgb[(y0 * src.width + x0) * 3], &src.rgb[(y0 * src.width + x1) * 3],
+				&src.rgb[(y1 * src.width + x0) * 3], &src.rgb[(y1 * src.width + x1) * 3]
+			};
+			for (size_t c = 0; c < 3; ++c)
+			{
+				// Duplicated edge pixels are counted once
+				size_t sum = p[0][c];
+				sum += (x1 != x0) ? p[1][c] : 0;
+				sum += (y1 != y0) ? p[2][c] : 0;
+				sum += ((x1 != x0) && (y1 != y0)) ? p[3][c] : 0;
+				*dest++ = static_cast<uint8_t>((sum + count / 2) / count);
+			}
+		}
+	}
+	return level;
+}
@@ -0,0 +1,58 @@
+#ifndef MIP_PYRAMID_H
+#define MIP_PYRAMID_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "LruCache.h"
+
+// Zoomed copies of a set of RGB images. Zooming in replicates pixels by an
+// integer factor; zooming out halves the next larger level with a 2x2 box
+// filter, so every level is built from a finished one rather than from the
+// full image. Levels below 1x are built the first time they are asked for,
+// and are dropped least recently used first once they exceed the budget.
+// Levels above 1x are cheap to rebuild and the caller keeps its own copy of
+// what it displays, so they are built afresh each time rather than cached.
+// No level may cost more than the whole budget; FindLargestZoom() gives the
+// largest zoom that can be had for an image. The source images themselves
+// are never dropped.
+class MipPyramid
+{
+public:
+	static const size_t DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+	struct Level
+	{
+		size_t width;
+		size_t height;
+		std::vector<uint8_t> rgb;
+	};
+
+	explicit MipPyramid(size_t budget = DEFAULT_BUDGET);
+
+	void SetImage(size_t id, const uint8_t* rgb, size_t width, size_t height);
+	bool HasImage(size_t id) const;
+	void Clear();
+	std::shared_ptr<const Level> GetLevel(size_t id, size_t zoom);
+	void SetBudget(size_t budget);
+	size_t GetBudget() const;
+	size_t GetUsage() const;
+
+	static size_t GetZoomCount();
+	static size_t GetUnityZoom();
+	static size_t FindZoom(size_t scale);
+	static double GetScale(size_t zoom);
+	static std::pair<size_t, size_t> GetLevelSize(size_t width, size_t height, size_t zoom);
+	static size_t GetLevelCost(size_t width, size_t height, size_t zoom);
+	static size_t FindLargestZoom(size_t width, size_t height, size_t budget);
+private:
+	static std::shared_ptr<const Level> Upscale(const Level& src, size_t factor);
+	static std::shared_ptr<const Level> Downscale(const Level& src);
+
+	std::map<size_t, std::shared_ptr<const Level>> m_sources;
+	LruCache<std::pair<size_t, size_t>, Level> m_levels;
+};
+
+#endif // MIP_PYRAMID_H
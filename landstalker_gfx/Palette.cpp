@@ -1,6 +1,7 @@
 #include "Palette.h"
 
 Palette::Palette()
+    : pal_(), rgba_()
 {
     pal_[0].r = 0x00;
     pal_[0].g = 0x00;
@@ -19,6 +20,7 @@ Palette::Palette()
         pal_[15].b = 0x00;
         pal_[15].a = 0xFF;
     }
+    updateLut();
 }
 
 Palette::Palette(const uint8_t* src, size_t offset, const PaletteType& type)
@@ -59,6 +61,7 @@ void Palette::Load(const uint8_t* src, size_t offset, const PaletteType& type)
         pal_[i].r = std::min(0xFF, (*src++ & 0x0F) * 18);
         pal_[i].a = 0xFF;
     }
+    updateLut();
 }
 
 uint8_t Palette::getR(uint8_t index) const
@@ -83,9 +86,31 @@ uint8_t Palette::getA(uint8_t index) const
 
 uint32_t Palette::getRGBA(uint8_t index) const
 {
-	uint32_t ret = pal_[index].r;
-    ret |= pal_[index].g << 8;
-    ret |= pal_[index].b << 16;
-    ret |= pal_[index].a << 24;
-    return ret;
+    return rgba_[index];
+}
+
+void Palette::set(uint8_t index, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+    pal_[index].r = r;
+    pal_[index].g = g;
+    pal_[index].b = b;
+    pal_[index].a = a;
+    updateLut();
+}
+
+const std::array<uint32_t, 16>& Palette::getRGBALut() const
+{
+    return rgba_;
+}
+
+void Palette::updateLut()
+{
+    for (size_t i = 0; i < rgba_.size(); ++i)
+    {
+        uint32_t rgba = pal_[i].r;
+        rgba |= pal_[i].g << 8;
+        rgba |= pal_[i].b << 16;
+        rgba |= static_cast<uint32_t>(pal_[i].a) << 24;
+        rgba_[i] = rgba;
+    }
 }
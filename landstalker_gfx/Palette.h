@@ -2,6 +2,7 @@
 #define PALETTE_H
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 
 class Palette
@@ -26,7 +27,11 @@ public:
     uint8_t getB(uint8_t index) const;
     uint8_t getA(uint8_t index) const;
     uint32_t getRGBA(uint8_t index) const;
+    void set(uint8_t index, uint8_t r, uint8_t g, uint8_t b, uint8_t a = 0xFF);
+    const std::array<uint32_t, 16>& getRGBALut() const;
 private:
+    void updateLut();
+
     struct PaletteEntry
     {
         uint8_t r;
@@ -36,6 +41,9 @@ private:
     };
 
     std::array<PaletteEntry, 16> pal_;
+    // Packed RGBA of each entry (R in the low byte), rebuilt whenever the
+    // palette is loaded so that conversions need a single lookup per pixel.
+    std::array<uint32_t, 16> rgba_;
 };
 
 #endif // PALETTE_H
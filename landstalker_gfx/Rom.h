@@ -58,6 +58,7 @@ public:
 	Rom& operator=(const Rom& rhs)
 	{
 		m_rom = rhs.m_rom;
+		m_initialised = rhs.m_initialised;
 		return *this;
 	}
 
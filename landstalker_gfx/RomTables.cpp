@@ -0,0 +1,176 @@
+#include "RomTables.h"
+
+#include <algorithm>
+
+RomTables::RomTables()
+{
+}
+
+void RomTables::Load(const Rom& rom)
+{
+	for (int section = 0; section < SECTION_COUNT; ++section)
+	{
+		Load(rom, static_cast<Section>(section));
+	}
+}
+
+void RomTables::Load(const Rom& rom, Section section)
+{
+	switch (section)
+	{
+	case SECTION_TILESETS:
+		LoadTilesets(rom);
+		break;
+	case SECTION_BIG_TILES:
+		LoadBigTiles(rom);
+		break;
+	case SECTION_ROOM_PALETTES:
+		LoadRoomPalettes(rom);
+		break;
+	case SECTION_ROOMS:
+		LoadRooms(rom);
+		break;
+	case SECTION_SPRITES:
+		LoadSprites(rom);
+		break;
+	default:
+		break;
+	}
+}
+
+void RomTables::LoadTilesets(const Rom& rom)
+{
+	tilesetOffsets = rom.read_array<uint32_t>(0x44070, TILESET_COUNT);
+}
+
+void RomTables::LoadBigTiles(const Rom& rom)
+{
+	bigTileTableOffsets = rom.read_array<uint32_t>(rom.read<uint32_t>(0x1AF800), BIG_TILESET_COUNT);
+	bigTileOffsets.clear();
+	for (size_t i = 0; i < BIG_TILESET_COUNT; ++i)
+	{
+		bigTileOffsets.push_back(rom.read_array<uint32_t>(bigTileTableOffsets[i], BIG_TILESET_PARTS));
+	}
+}
+
+void RomTables::LoadRoomPalettes(const Rom& rom)
+{
+	const uint8_t* const base_pal = rom.data(rom.read<uint32_t>(0xA0A04));
+	roomPalettes.clear();
+	for (size_t i = 0; i < ROOM_PALETTE_COUNT; ++i)
+	{
+		roomPalettes.push_back(Palette(base_pal, i, Palette::ROOM_PALETTE));
+	}
+}
+
+void RomTables::LoadRooms(const Rom& rom)
+{
+	const uint8_t* rm = rom.data(rom.read<uint32_t>(0xA0A00));
+	rooms.clear();
+	rooms.reserve(ROOM_COUNT);
+	for (size_t i = 0; i < ROOM_COUNT; i++)
+	{
+		rooms.push_back(RoomData(rm));
+		rm += 8;
+	}
+}
+
+void RomTables::LoadSprites(const Rom& rom)
+{
+	const uint32_t start_of_sprite_graphics = 0x120000;
+	const uint32_t start_of_sprite_table = start_of_sprite_graphics + 4;
+	const uint32_t start_of_anim_table = rom.read<uint32_t>(start_of_sprite_graphics);
+	const uint32_t start_of_frame_table = rom.read<uint32_t>(start_of_anim_table);
+	const uint32_t start_of_frames = rom.read<uint32_t>(start_of_frame_table);
+
+	spriteFrameOffsets = rom.read_array<uint32_t>(start_of_frame_table, (start_of_frames - start_of_frame_table) / 4);
+	std::sort(spriteFrameOffsets.begin(), spriteFrameOffsets.end());
+	spriteFrameOffsets.erase(std::unique(spriteFrameOffsets.begin(), spriteFrameOffsets.end()), spriteFrameOffsets.end());
+
+	spriteGraphics.clear();
+	spriteGraphics.reserve((start_of_anim_table - start_of_sprite_table) / 4);
+	size_t i = 0;
+	for (uint32_t soffset = start_of_sprite_table; soffset < start_of_anim_table; soffset += 4)
+	{
+		spriteGraphics.emplace_back(i++);
+		uint32_t start_anim_offset = rom.read<uint16_t>(soffset) * 4 + start_of_anim_table;
+		uint32_t end_anim_offset;
+		if (soffset + 4 >= start_of_anim_table)
+		{
+			end_anim_offset = start_of_frame_table;
+		}
+		else
+		{
+			end_anim_offset = rom.read<uint16_t>(soffset + 4) * 4 + start_of_anim_table;
+		}
+		for (uint32_t aoffset = start_anim_offset; aoffset < end_anim_offset; aoffset += 4)
+		{
+			uint32_t start_frame_offset = rom.read<uint32_t>(aoffset);
+			uint32_t end_frame_offset;
+			if (aoffset + 4 >= start_of_frames)
+			{
+				end_frame_offset = start_of_frames;
+			}
+			else
+			{
+				end_frame_offset = rom.read<uint32_t>(aoffset + 4);
+			}
+			std::vector<uint32_t> sframes = rom.read_array<uint32_t>(start_frame_offset, (end_frame_offset - start_frame_offset) / 4);
+			for (auto& frame : sframes)
+			{
+				frame = std::lower_bound(spriteFrameOffsets.cbegin(), spriteFrameOffsets.cend(), frame) - spriteFrameOffsets.cbegin();
+			}
+			spriteGraphics.back().AddAnimation(sframes);
+		}
+	}
+
+	// Sprite IDs are a single byte, so the sprite table is indexed directly.
+	// The first entry for a given ID wins.
+	sprites.fill(Sprite());
+	spriteIds.clear();
+	std::array<bool, 256> sprite_defined;
+	sprite_defined.fill(false);
+	for (size_t i = 0; i < (SPRITE_TABLE_COUNT * 2); i += 2)
+	{
+		uint8_t sprite_idx = rom.read<uint8_t>(0x1ABF2 + i + 1);
+		uint8_t sprite_gfx = rom.read<uint8_t>(0x1ABF2 + i);
+		if (!sprite_defined[sprite_idx])
+		{
+			sprite_defined[sprite_idx] = true;
+			sprites[sprite_idx] = Sprite(sprite_gfx);
+			spriteIds.push_back(sprite_idx);
+		}
+	}
+	std::sort(spriteIds.begin(), spriteIds.end());
+
+	for (size_t offset = 0x1A453A; rom.read<uint8_t>(offset) != 0xFF; offset += 2)
+	{
+		if ((rom.read<uint8_t>(offset + 1) & 0x80) > 0)
+		{
+			sprites[rom.read<uint8_t>(offset)].SetHighPalette(rom.read<uint8_t>(offset + 1) & 0x7F);
+		}
+		else
+		{
+			sprites[rom.read<uint8_t>(offset)].SetLowPalette(rom.read<uint8_t>(offset + 1));
+		}
+	}
+}
+
+const char* RomTables::GetSectionName(Section section)
+{
+	switch (section)
+	{
+	case SECTION_TILESETS:
+		return "tilesets";
+	case SECTION_BIG_TILES:
+		return "big tilesets";
+	case SECTION_ROOM_PALETTES:
+		return "room palettes";
+	case SECTION_ROOMS:
+		return "rooms";
+	case SECTION_SPRITES:
+		return "sprites";
+	default:
+		return "";
+	}
+}
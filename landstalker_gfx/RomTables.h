@@ -0,0 +1,89 @@
+#ifndef ROM_TABLES_H
+#define ROM_TABLES_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "Rom.h"
+#include "Palette.h"
+#include "Sprite.h"
+#include "SpriteGraphic.h"
+
+// Where each asset lives in the ROM, read from the game's own pointer tables.
+// The tables fall into independent sections, so each can be loaded on its
+// own thread; loading a section only writes that section's members.
+class RomTables
+{
+public:
+	struct RoomData
+	{
+		uint32_t offset;
+		uint8_t tileset;
+		uint8_t priBigTileset;
+		uint8_t secBigTileset;
+		uint8_t bigTilesetIdx;
+		uint8_t roomPalette;
+		uint8_t backgroundMusic;
+		uint8_t unknownParam1;
+		uint8_t unknownParam2;
+		uint8_t unknownParam3;
+
+		RoomData(const uint8_t* src)
+		:   offset((src[0] << 24) | (src[1] << 16) | (src[2] << 8) | src[3]),
+			tileset(src[4] & 0x1F),
+			priBigTileset((src[4] >> 5) & 0x01),
+			secBigTileset((src[7] >> 5) & 0x07),
+			bigTilesetIdx(priBigTileset << 5 | tileset),
+			roomPalette(src[5] & 0x3F),
+			backgroundMusic(src[7] & 0x1F),
+			unknownParam1((src[4] >> 6) & 0x03),
+			unknownParam2((src[5] >> 6) & 0x03),
+			unknownParam3(src[6])
+		{
+		}
+	};
+
+	enum Section
+	{
+		SECTION_TILESETS,
+		SECTION_BIG_TILES,
+		SECTION_ROOM_PALETTES,
+		SECTION_ROOMS,
+		SECTION_SPRITES,
+		SECTION_COUNT
+	};
+
+	static const size_t TILESET_COUNT = 31;
+	static const size_t BIG_TILESET_COUNT = 64;
+	static const size_t BIG_TILESET_PARTS = 9;
+	static const size_t ROOM_PALETTE_COUNT = 54;
+	static const size_t ROOM_COUNT = 816;
+	static const size_t SPRITE_TABLE_COUNT = 236;
+	static const uint32_t SPRITE_HIGH_PALETTES = 0x1A4BA0;
+	static const uint32_t SPRITE_LOW_PALETTES = 0x1A47E0;
+
+	RomTables();
+
+	void Load(const Rom& rom);
+	void Load(const Rom& rom, Section section);
+	void LoadTilesets(const Rom& rom);
+	void LoadBigTiles(const Rom& rom);
+	void LoadRoomPalettes(const Rom& rom);
+	void LoadRooms(const Rom& rom);
+	void LoadSprites(const Rom& rom);
+	static const char* GetSectionName(Section section);
+
+	std::vector<uint32_t> tilesetOffsets;
+	std::vector<uint32_t> bigTileTableOffsets;
+	std::vector<std::vector<uint32_t>> bigTileOffsets;
+	std::vector<Palette> roomPalettes;
+	std::vector<RoomData> rooms;
+	// Sorted, de-duplicated offsets of every sprite frame; a frame's number
+	// is its position in this list
+	std::vector<uint32_t> spriteFrameOffsets;
+	std::vector<SpriteGraphic> spriteGraphics;
+	std::array<Sprite, 256> sprites;
+	std::vector<uint8_t> spriteIds;
+};
+
+#endif // ROM_TABLES_H
@@ -0,0 +1,147 @@
+#include "RoomPrefetcher.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+RoomPrefetcher::RoomPrefetcher(const AssetCache& cache, ThreadPool& pool, size_t budget, size_t max_rooms)
+	: m_cache(cache), m_pool(pool), m_budget(budget), m_max_rooms(max_rooms), m_generation(0), m_prefetched(0)
+{
+}
+
+void RoomPrefetcher::Start(uint16_t room, const std::vector<RomTables::RoomData>& rooms,
+                           const std::vector<uint32_t>& tileset_offsets,
+                           const std::vector<std::vector<uint32_t>>& big_tile_offsets)
+{
+	// The offsets are resolved here, so the task never touches the caller's
+	// tables once it is running
+	std::vector<Target> targets;
+	for (uint16_t candidate : GetCandidates(room, rooms, m_max_rooms))
+	{
+		const RomTables::RoomData& rd = rooms[candidate];
+		if ((rd.tileset >= tileset_offsets.size()) ||
+		    (rd.bigTilesetIdx >= big_tile_offsets.size()) ||
+		    (1u + rd.secBigTileset >= big_tile_offsets[rd.bigTilesetIdx].size()))
+		{
+			continue;
+		}
+		const Target target = { tileset_offsets[rd.tileset],
+		                        big_tile_offsets[rd.bigTilesetIdx][0],
+		                        big_tile_offsets[rd.bigTilesetIdx][1 + rd.secBigTileset],
+		                        rd.offset };
+		targets.push_back(target);
+	}
+
+	const unsigned generation = ++m_generation;
+	if (!targets.empty())
+	{
+		m_pool.Submit([this, targets, generation]()
+		{
+			Prefetch(targets, generation);
+		});
+	}
+}
+
+void RoomPrefetcher::Cancel()
+{
+	++m_generation;
+}
+
+void RoomPrefetcher::SetBudget(size_t budget)
+{
+	m_budget = budget;
+}
+
+size_t RoomPrefetcher::GetBudget() const
+{
+	return m_budget;
+}
+
+size_t RoomPrefetcher::GetPrefetchedCount() const
+{
+	return m_prefetched;
+}
+
+std::vector<uint16_t> RoomPrefetcher::GetCandidates(uint16_t room, const std::vector<RomTables::RoomData>& rooms, size_t max_rooms)
+{
+	std::vector<uint16_t> candidates;
+	if (room >= rooms.size())
+	{
+		return candidates;
+	}
+	if (room + 1u < rooms.size())
+	{
+		candidates.push_back(room + 1);
+	}
+	if (room > 0)
+	{
+		candidates.push_back(room - 1);
+	}
+
+	std::vector<uint16_t> related;
+	const RomTables::RoomData& current = rooms[room];
+	for (size_t i = 0; i < rooms.size(); ++i)
+	{
+		if ((i + 1 == room) || (i == room) || (i == room + 1u))
+		{
+			continue;
+		}
+		if ((rooms[i].tileset == current.tileset) || (rooms[i].bigTilesetIdx == current.bigTilesetIdx))
+		{
+			related.push_back(static_cast<uint16_t>(i));
+		}
+	}
+	std::stable_sort(related.begin(), related.end(), [room](uint16_t a, uint16_t b)
+	{
+		return std::abs(a - room) < std::abs(b - room);
+	});
+	candidates.insert(candidates.end(), related.begin(), related.end());
+
+	if (candidates.size() > max_rooms)
+	{
+		candidates.resize(max_rooms);
+	}
+	return candidates;
+}
+
+void RoomPrefetcher::Prefetch(const std::vector<Target>& targets, unsigned generation)
+{
+	// Only data the cache didn't already hold is charged to the budget, so
+	// rooms sharing a tileset pay for it once
+	size_t spent = 0;
+	try
+	{
+		for (const Target& target : targets)
+		{
+			if ((m_generation != generation) || (spent >= m_budget))
+			{
+				return;
+			}
+			if (!m_cache.ContainsTileset(target.tileset))
+			{
+				spent += AssetCache::GetCost(*m_cache.GetTileset(target.tileset));
+			}
+			if (m_generation != generation)
+			{
+				return;
+			}
+			if (!m_cache.ContainsBlockset(target.blockset_primary, target.blockset_secondary))
+			{
+				spent += AssetCache::GetCost(*m_cache.GetBlockset(target.blockset_primary, target.blockset_secondary));
+			}
+			if (m_generation != generation)
+			{
+				return;
+			}
+			if (!m_cache.ContainsRoomMap(target.map))
+			{
+				spent += AssetCache::GetCost(*m_cache.GetRoomMap(target.map));
+				m_prefetched++;
+			}
+		}
+	}
+	catch (const std::exception&)
+	{
+		// The ROM was closed under us; whatever was wanted is gone anyway
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef ROOM_PREFETCHER_H
+#define ROOM_PREFETCHER_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "AssetCache.h"
+#include "RomTables.h"
+#include "ThreadPool.h"
+
+// Speculatively decodes the rooms a user is likely to open next into the
+// asset cache: the rooms either side of the current one, then the rooms that
+// share its tileset or blockset, nearest first. The work runs as a single
+// task, so at most one worker is ever busy with it, and it stops as soon as
+// it is cancelled or has brought its budget's worth of new data into the
+// cache.
+class RoomPrefetcher
+{
+public:
+	static const size_t DEFAULT_BUDGET = 8 * 1024 * 1024;
+	static const size_t DEFAULT_MAX_ROOMS = 24;
+
+	RoomPrefetcher(const AssetCache& cache, ThreadPool& pool, size_t budget = DEFAULT_BUDGET, size_t max_rooms = DEFAULT_MAX_ROOMS);
+
+	void Start(uint16_t room, const std::vector<RomTables::RoomData>& rooms,
+	           const std::vector<uint32_t>& tileset_offsets,
+	           const std::vector<std::vector<uint32_t>>& big_tile_offsets);
+	void Cancel();
+	void SetBudget(size_t budget);
+	size_t GetBudget() const;
+	size_t GetPrefetchedCount() const;
+
+	static std::vector<uint16_t> GetCandidates(uint16_t room, const std::vector<RomTables::RoomData>& rooms, size_t max_rooms);
+private:
+	struct Target
+	{
+		uint32_t tileset;
+		uint32_t blockset_primary;
+		uint32_t blockset_secondary;
+		uint32_t map;
+	};
+
+	void Prefetch(const std::vector<Target>& targets, unsigned generation);
+
+	const AssetCache& m_cache;
+	ThreadPool& m_pool;
+	std::atomic<size_t> m_budget;
+	const size_t m_max_rooms;
+	std::atomic<unsigned> m_generation;
+	std::atomic<size_t> m_prefetched;
+};
+
+#endif // ROOM_PREFETCHER_H
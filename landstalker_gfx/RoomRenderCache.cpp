@@ -0,0 +1,122 @@
+#include "RoomRenderCache.h"
+
+#include <algorithm>
+
+RoomRenderCache::RoomRenderCache()
+	: m_valid(false), m_room(0), m_palette(0), m_width(0), m_height(0)
+{
+}
+
+void RoomRenderCache::Clear()
+{
+	m_valid = false;
+	for (auto& layer : m_layers)
+	{
+		layer = LayerPixels();
+	}
+	m_composite.clear();
+}
+
+bool RoomRenderCache::IsValid(uint16_t room, uint8_t palette) const
+{
+	return m_valid && (m_room == room) && (m_palette == palette);
+}
+
+// Starts a new set of layers. Layers that are not set are left empty, and
+// are skipped when compositing.
+void RoomRenderCache::Begin(uint16_t room, uint8_t palette, size_t width, size_t height)
+{
+	Clear();
+	m_room = room;
+	m_palette = palette;
+	m_width = width;
+	m_height = height;
+	m_valid = true;
+}
+
+void RoomRenderCache::SetLayer(Layer layer, const ImageBuffer& image, const std::vector<Palette>& pals)
+{
+	LayerPixels& pixels = m_layers[layer];
+	pixels.rgb = image.GetRGB(pals);
+	// The alpha of each pixel is taken once with only low priority pixels
+	// visible, and once with only high; whichever is set gives both the
+	// pixel's own alpha and its priority.
+	pixels.alpha = image.GetAlpha(pals, 0xFF, 0);
+	pixels.priority = image.GetAlpha(pals, 0, 0xFF);
+	for (size_t i = 0; i < pixels.alpha.size(); ++i)
+	{
+		if (pixels.priority[i] != 0)
+		{
+			pixels.alpha[i] = pixels.priority[i];
+			pixels.priority[i] = 1;
+		}
+	}
+}
+
+void RoomRenderCache::SetLayer(Layer layer, const std::vector<uint8_t>& rgba)
+{
+	LayerPixels& pixels = m_layers[layer];
+	if (rgba.size() != m_width * m_height * 4)
+	{
+		pixels = LayerPixels();
+		return;
+	}
+	pixels.rgb.resize(m_width * m_height * 3);
+	pixels.alpha.resize(m_width * m_height);
+	pixels.priority.assign(m_width * m_height, 0);
+	auto src = rgba.cbegin();
+	auto rgb = pixels.rgb.begin();
+	for (auto& alpha : pixels.alpha)
+	{
+		*rgb++ = *src++;
+		*rgb++ = *src++;
+		*rgb++ = *src++;
+		alpha = *src++;
+	}
+}
+
+// Blends the layers in order over black, as RGB. A layer's pixels are
+// limited to the opacity given for their priority.
+const std::vector<uint8_t>& RoomRenderCache::Composite(const std::array<LayerOpacity, LAYER_COUNT>& opacity)
+{
+	m_composite.assign(m_width * m_height * 3, 0);
+	for (size_t l = 0; l < LAYER_COUNT; ++l)
+	{
+		const LayerPixels& layer = m_layers[l];
+		const uint8_t max_opacity[2] = { opacity[l].low, opacity[l].high };
+		if ((layer.alpha.size() != m_width * m_height) || ((max_opacity[0] | max_opacity[1]) == 0))
+		{
+			continue;
+		}
+		auto src = layer.rgb.cbegin();
+		auto dest = m_composite.begin();
+		for (size_t i = 0; i < layer.alpha.size(); ++i)
+		{
+			const unsigned a = std::min(layer.alpha[i], max_opacity[layer.priority[i]]);
+			if (a == 0xFF)
+			{
+				std::copy(src, src + 3, dest);
+			}
+			else if (a != 0)
+			{
+				for (size_t c = 0; c < 3; ++c)
+				{
+					dest[c] = (src[c] * a + dest[c] * (0xFF - a) + 0x7F) / 0xFF;
+				}
+			}
+			src += 3;
+			dest += 3;
+		}
+	}
+	return m_composite;
+}
+
+size_t RoomRenderCache::GetWidth() const
+{
+	return m_width;
+}
+
+size_t RoomRenderCache::GetHeight() const
+{
+	return m_height;
+}
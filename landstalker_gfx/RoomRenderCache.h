@@ -0,0 +1,58 @@
+#ifndef ROOM_RENDER_CACHE_H
+#define ROOM_RENDER_CACHE_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "ImageBuffer.h"
+#include "Palette.h"
+
+// Finished pixels of each layer of a room, drawn at full opacity. Changing a
+// layer's opacity or visibility then only needs the layers blended again,
+// rather than redrawing them from tiles.
+class RoomRenderCache
+{
+public:
+	enum Layer
+	{
+		LAYER_BACKGROUND,
+		LAYER_FOREGROUND,
+		LAYER_HEIGHTMAP,
+		LAYER_COUNT
+	};
+
+	// Maximum opacity of the low and high priority pixels of a layer
+	struct LayerOpacity
+	{
+		uint8_t low;
+		uint8_t high;
+	};
+
+	RoomRenderCache();
+
+	void Clear();
+	bool IsValid(uint16_t room, uint8_t palette) const;
+	void Begin(uint16_t room, uint8_t palette, size_t width, size_t height);
+	void SetLayer(Layer layer, const ImageBuffer& image, const std::vector<Palette>& pals);
+	void SetLayer(Layer layer, const std::vector<uint8_t>& rgba);
+	const std::vector<uint8_t>& Composite(const std::array<LayerOpacity, LAYER_COUNT>& opacity);
+	size_t GetWidth() const;
+	size_t GetHeight() const;
+private:
+	struct LayerPixels
+	{
+		std::vector<uint8_t> rgb;
+		std::vector<uint8_t> alpha;
+		std::vector<uint8_t> priority;
+	};
+
+	bool m_valid;
+	uint16_t m_room;
+	uint8_t m_palette;
+	size_t m_width;
+	size_t m_height;
+	std::array<LayerPixels, LAYER_COUNT> m_layers;
+	std::vector<uint8_t> m_composite;
+};
+
+#endif // ROOM_RENDER_CACHE_H
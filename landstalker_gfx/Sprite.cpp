@@ -1,12 +1,12 @@
 #include "Sprite.h"
 
 Sprite::Sprite()
-	: m_sprite_gfx_idx(-1), m_high_palette(-1), m_low_palette(-1)
+	: m_sprite_gfx_idx(-1), m_high_palette(-1), m_low_palette(-1), m_palette_valid(false)
 {
 }
 
 Sprite::Sprite(uint8_t graphics)
-	: m_sprite_gfx_idx(graphics), m_high_palette(-1), m_low_palette(-1)
+	: m_sprite_gfx_idx(graphics), m_high_palette(-1), m_low_palette(-1), m_palette_valid(false)
 {
 }
 
@@ -18,23 +18,34 @@ uint8_t Sprite::GetGraphicsIdx() const
 void Sprite::SetHighPalette(uint8_t id)
 {
 	m_high_palette = id;
+	InvalidatePalette();
 }
 
 void Sprite::SetLowPalette(uint8_t id)
 {
 	m_low_palette = id;
+	InvalidatePalette();
 }
 
-Palette Sprite::GetPalette(const uint8_t* high_src, const uint8_t* low_src) const
+const Palette& Sprite::GetPalette(const uint8_t* high_src, const uint8_t* low_src) const
 {
-	Palette pal;
-	if (m_high_palette != -1)
+	if (!m_palette_valid)
 	{
-		pal.Load(high_src, m_high_palette, Palette::SPRITE_HIGH_PALETTE);
+		m_palette = Palette();
+		if (m_high_palette != -1)
+		{
+			m_palette.Load(high_src, m_high_palette, Palette::SPRITE_HIGH_PALETTE);
+		}
+		if (m_low_palette != -1)
+		{
+			m_palette.Load(low_src, m_low_palette, Palette::SPRITE_LOW_PALETTE);
+		}
+		m_palette_valid = true;
 	}
-	if (m_low_palette != -1)
-	{
-		pal.Load(low_src, m_low_palette, Palette::SPRITE_LOW_PALETTE);
-	}
-	return pal;
+	return m_palette;
+}
+
+void Sprite::InvalidatePalette()
+{
+	m_palette_valid = false;
 }
@@ -12,11 +12,16 @@ public:
 	uint8_t GetGraphicsIdx() const;
 	void SetHighPalette(uint8_t id);
 	void SetLowPalette(uint8_t id);
-	Palette GetPalette(const uint8_t* high_src, const uint8_t* low_src) const;
+	const Palette& GetPalette(const uint8_t* high_src, const uint8_t* low_src) const;
+	void InvalidatePalette();
 private:
 	uint8_t m_sprite_gfx_idx;
 	int m_high_palette;
 	int m_low_palette;
+	// Resolved on first use and kept until the palette assignment changes.
+	// The sprite table is rebuilt when a ROM is loaded, which also drops it.
+	mutable Palette m_palette;
+	mutable bool m_palette_valid;
 };
 
 #endif // SPRITE_H
@@ -0,0 +1,49 @@
+#include "SpriteAnimator.h"
+
+SpriteAnimator::SpriteAnimator()
+	: m_frame_count(0), m_ticks_per_frame(DEFAULT_TICKS_PER_FRAME), m_current(0), m_running(false)
+{
+}
+
+void SpriteAnimator::Start(size_t frame_count, unsigned ticks_per_frame, Clock::time_point now)
+{
+	m_start = now;
+	m_frame_count = frame_count;
+	m_ticks_per_frame = (ticks_per_frame > 0) ? ticks_per_frame : 1;
+	m_current = 0;
+	m_running = (frame_count > 1);
+}
+
+void SpriteAnimator::Stop()
+{
+	m_running = false;
+}
+
+bool SpriteAnimator::Update(Clock::time_point now)
+{
+	if (!m_running)
+	{
+		return false;
+	}
+	const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - m_start).count();
+	const long long ticks = elapsed * GAME_FRAME_RATE / 1000000;
+	const size_t next = static_cast<size_t>(ticks / m_ticks_per_frame) % m_frame_count;
+	const bool changed = (next != m_current);
+	m_current = next;
+	return changed;
+}
+
+bool SpriteAnimator::IsRunning() const
+{
+	return m_running;
+}
+
+size_t SpriteAnimator::GetCurrentIndex() const
+{
+	return m_current;
+}
+
+size_t SpriteAnimator::GetFrameCount() const
+{
+	return m_frame_count;
+}
@@ -0,0 +1,36 @@
+#ifndef SPRITE_ANIMATOR_H
+#define SPRITE_ANIMATOR_H
+
+#include <chrono>
+#include <cstddef>
+
+// Works out which frame of an animation should be on screen. Time is
+// measured in game ticks (60 per second), and each animation frame is held
+// for a fixed number of ticks. The frame is derived from the elapsed time
+// rather than by counting timer events, so late or dropped timer events
+// never slow the animation down.
+class SpriteAnimator
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	static const unsigned GAME_FRAME_RATE = 60;
+	static const unsigned DEFAULT_TICKS_PER_FRAME = 8;
+
+	SpriteAnimator();
+
+	void Start(size_t frame_count, unsigned ticks_per_frame = DEFAULT_TICKS_PER_FRAME, Clock::time_point now = Clock::now());
+	void Stop();
+	bool Update(Clock::time_point now = Clock::now());
+	bool IsRunning() const;
+	size_t GetCurrentIndex() const;
+	size_t GetFrameCount() const;
+private:
+	Clock::time_point m_start;
+	size_t m_frame_count;
+	unsigned m_ticks_per_frame;
+	size_t m_current;
+	bool m_running;
+};
+
+#endif // SPRITE_ANIMATOR_H
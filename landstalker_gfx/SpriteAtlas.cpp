@@ -0,0 +1,185 @@
+#include "SpriteAtlas.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+SpriteAtlas::SpriteAtlas(size_t page_width, size_t page_height)
+	: m_page_width(page_width), m_page_height(page_height)
+{
+}
+
+void SpriteAtlas::Clear()
+{
+	m_pages.clear();
+	m_entries.clear();
+}
+
+void SpriteAtlas::Build(const std::map<size_t, std::shared_ptr<const SpriteFrame>>& frames, uint8_t palette_index)
+{
+	std::vector<Item> items;
+	for (const auto& frame : frames)
+	{
+		items.emplace_back(frame.first, frame.second->GetBounds());
+	}
+	Pack(items, [&](size_t id, int x, int y, ImageBuffer& page)
+	{
+		page.InsertSprite(x, y, palette_index, *frames.at(id));
+	});
+}
+
+// Packs frames straight from the tiles they share, without decoding them.
+// Ids are frame numbers in the store, and repeated ids are packed once.
+void SpriteAtlas::Build(const std::vector<size_t>& ids, const SpriteTileStore& tiles, uint8_t palette_index)
+{
+	std::map<size_t, SpriteFrame::Bounds> unique;
+	for (size_t id : ids)
+	{
+		unique.insert(std::make_pair(id, SpriteFrame::GetBounds(tiles.GetSubSprites(id))));
+	}
+	Pack(std::vector<Item>(unique.begin(), unique.end()), [&](size_t id, int x, int y, ImageBuffer& page)
+	{
+		page.InsertSprite(x, y, palette_index, tiles, id);
+	});
+}
+
+// Items must be in ascending id order. The frame drawer is given each frame's
+// id and the position of its origin on the page it has been placed in.
+template <class DrawFrame>
+void SpriteAtlas::Pack(std::vector<Item> items, DrawFrame draw_frame)
+{
+	Clear();
+	if (items.empty())
+	{
+		return;
+	}
+	m_entries.assign(items.back().first + 1, Entry{ NO_PAGE, 0, 0, 0, 0, 0, 0 });
+
+	// Placing the tallest frames first keeps the skyline flat
+	std::stable_sort(items.begin(), items.end(), [](const Item& lhs, const Item& rhs)
+	{
+		return lhs.second.height > rhs.second.height;
+	});
+
+	std::vector<SkylineSegment> skyline;
+	for (const auto& item : items)
+	{
+		const SpriteFrame::Bounds& bounds = item.second;
+		if ((bounds.width > m_page_width) || (bounds.height > m_page_height))
+		{
+			std::ostringstream ss;
+			ss << "Sprite frame " << item.first << " (" << bounds.width << "x" << bounds.height
+			   << ") does not fit in a " << m_page_width << "x" << m_page_height << " atlas page.";
+			throw std::runtime_error(ss.str());
+		}
+		size_t x = 0, y = 0, idx = 0;
+		if (m_pages.empty() || !FindPosition(skyline, bounds.width, bounds.height, x, y, idx))
+		{
+			m_pages.emplace_back(m_page_width, m_page_height);
+			skyline.assign(1, SkylineSegment{ 0, 0, m_page_width });
+			FindPosition(skyline, bounds.width, bounds.height, x, y, idx);
+		}
+		AddSkylineLevel(skyline, idx, x, y, bounds.width, bounds.height);
+		m_entries[item.first] = Entry{ m_pages.size() - 1, x, y, bounds.width, bounds.height, bounds.left, bounds.top };
+		draw_frame(item.first, static_cast<int>(x) - bounds.left, static_cast<int>(y) - bounds.top, m_pages.back());
+	}
+}
+
+bool SpriteAtlas::Contains(size_t id) const
+{
+	return (id < m_entries.size()) && (m_entries[id].page != NO_PAGE);
+}
+
+const SpriteAtlas::Entry& SpriteAtlas::GetEntry(size_t id) const
+{
+	if (!Contains(id))
+	{
+		std::ostringstream ss;
+		ss << "Sprite frame " << id << " is not in the atlas.";
+		throw std::runtime_error(ss.str());
+	}
+	return m_entries[id];
+}
+
+const ImageBuffer& SpriteAtlas::GetPage(size_t page) const
+{
+	return m_pages.at(page);
+}
+
+size_t SpriteAtlas::GetPageCount() const
+{
+	return m_pages.size();
+}
+
+void SpriteAtlas::Draw(size_t id, ImageBuffer& dest, size_t x, size_t y) const
+{
+	const Entry& entry = GetEntry(id);
+	dest.Blit(x, y, m_pages[entry.page], entry.x, entry.y, entry.width, entry.height);
+}
+
+bool SpriteAtlas::FindPosition(const std::vector<SkylineSegment>& skyline, size_t width, size_t height, size_t& best_x, size_t& best_y, size_t& best_idx) const
+{
+	bool found = false;
+	for (size_t i = 0; i < skyline.size(); ++i)
+	{
+		const size_t x = skyline[i].x;
+		if (x + width > m_page_width)
+		{
+			break;
+		}
+		// The rectangle rests on the highest segment it spans
+		size_t y = 0;
+		size_t spanned = 0;
+		for (size_t j = i; (j < skyline.size()) && (spanned < width); ++j)
+		{
+			y = std::max(y, skyline[j].y);
+			spanned += skyline[j].width;
+		}
+		if ((y + height <= m_page_height) && (!found || (y < best_y) || ((y == best_y) && (x < best_x))))
+		{
+			found = true;
+			best_x = x;
+			best_y = y;
+			best_idx = i;
+		}
+	}
+	return found;
+}
+
+void SpriteAtlas::AddSkylineLevel(std::vector<SkylineSegment>& skyline, size_t idx, size_t x, size_t y, size_t width, size_t height) const
+{
+	skyline.insert(skyline.begin() + idx, SkylineSegment{ x, y + height, width });
+	// Trim or remove the segments now covered by the new one
+	for (size_t i = idx + 1; i < skyline.size();)
+	{
+		const size_t end = x + width;
+		if (skyline[i].x >= end)
+		{
+			break;
+		}
+		const size_t overlap = end - skyline[i].x;
+		if (overlap >= skyline[i].width)
+		{
+			skyline.erase(skyline.begin() + i);
+		}
+		else
+		{
+			skyline[i].x += overlap;
+			skyline[i].width -= overlap;
+			break;
+		}
+	}
+	// Merge neighbouring segments at the same height
+	for (size_t i = 0; i + 1 < skyline.size();)
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#ifndef SPRITE_ATLAS_H
+#define SPRITE_ATLAS_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include "ImageBuffer.h"
+#include "SpriteFrame.h"
+#include "SpriteTileStore.h"
+
+// Packs sprite frames into one or more large ImageBuffer pages using a
+// skyline bottom-left packer. Each frame is cropped to the bounding box of its
+// subsprites, and its position is kept in a flat table indexed by frame id so
+// that drawing a frame is a single sub-rectangle copy. Frames can be packed
+// from their decoded form or straight from a shared sprite tile store.
+class SpriteAtlas
+{
+public:
+	struct Entry
+	{
+		size_t page;
+		size_t x;
+		size_t y;
+		size_t width;
+		size_t height;
+		int origin_x;
+		int origin_y;
+	};
+
+	static const size_t DEFAULT_PAGE_WIDTH = 512;
+	static const size_t DEFAULT_PAGE_HEIGHT = 512;
+	static const size_t NO_PAGE = static_cast<size_t>(-1);
+
+	SpriteAtlas(size_t page_width = DEFAULT_PAGE_WIDTH, size_t page_height = DEFAULT_PAGE_HEIGHT);
+
+	void Clear();
+	void Build(const std::map<size_t, std::shared_ptr<const SpriteFrame>>& frames, uint8_t palette_index = 0);
+	void Build(const std::vector<size_t>& ids, const SpriteTileStore& tiles, uint8_t palette_index = 0);
+	bool Contains(size_t id) const;
+	const Entry& GetEntry(size_t id) const;
+	const ImageBuffer& GetPage(size_t page) const;
+	size_t GetPageCount() const;
+	void Draw(size_t id, ImageBuffer& dest, size_t x, size_t y) const;
+private:
+	struct SkylineSegment
+	{
+		size_t x;
+		size_t y;
+		size_t width;
+	};
+
+	typedef std::pair<size_t, SpriteFrame::Bounds> Item;
+
+	template <class DrawFrame>
+	void Pack(std::vector<Item> items, DrawFrame draw_frame);
+	bool FindPosition(const std::vector<SkylineSegment>& skyline, size_t width, size_t height, size_t& best_x, size_t& best_y, size_t& best_idx) const;
+	void AddSkylineLevel(std::vector<SkylineSegment>& skyline, size_t idx, size_t x, size_t y, size_t width, size_t height) const;
+
+	size_t m_page_width;
+	size_t m_page_height;
+	std::vector<ImageBuffer> m_pages;
+	std::vector<Entry> m_entries;
+};
+
+#endif // SPRITE_ATLAS_H
@@ -1,11 +1,14 @@
 #include "SpriteFrame.h"
 #include <vector>
+#include <algorithm>
 #include "Rom.h"
 #include "LZ77.h"
-#include "Utils.h"
+#include "Log.h"
 
 SpriteFrame::SpriteFrame(const uint8_t* src)
+	: m_compressed_size(0), m_uncompressed_size(0)
 {
+	const uint8_t* const start = src;
 	size_t tile_idx = 0;
 	do
 	{
@@ -17,15 +20,11 @@ SpriteFrame::SpriteFrame(const uint8_t* src)
 		tile_idx += w * h;
 	} while ((*src++ & 0x80) == 0);
 
-	for (const auto subs : m_subsprites)
+	for (const auto& subs : m_subsprites)
 	{
-		std::ostringstream ss;
-		ss << "Sprite T:" << subs.tile_idx << " X:" << subs.x << " Y:" << subs.y << " W:" << subs.w << " H:" << subs.h << std::endl;
-		Debug(ss.str().c_str());
+		LOG_TRACE(Log::CAT_SPRITE, "Sprite T:" << subs.tile_idx << " X:" << subs.x << " Y:" << subs.y << " W:" << subs.w << " H:" << subs.h);
 	}
-	std::ostringstream ss;
-	ss << "Total tiles to load: " << tile_idx << std::endl;
-	Debug(ss.str().c_str());
+	LOG_DEBUG(Log::CAT_SPRITE, "Total tiles to load: " << tile_idx);
 	std::vector<uint8_t> sprite_gfx(tile_idx * 32, 0);
 	auto dest_it = sprite_gfx.begin();
 
@@ -41,25 +40,20 @@ SpriteFrame::SpriteFrame(const uint8_t* src)
 
 		if ((ctrl & 0x08) > 0)
 		{
-			std::ostringstream ss;
-			ss << "Insert " << count << " zero words." << std::endl;
-			Debug(ss.str().c_str());
+			LOG_TRACE(Log::CAT_SPRITE, "Insert " << count << " zero words.");
 			dest_it += count * 2;
 		}
 		else if ((ctrl & 0x02) > 0)
 		{
-			std::ostringstream ss;
 			size_t elen = 0;
-			src += LZ77::Decode(src, count, &(*dest_it), elen);
-			ss << "Copy " << count << " compressed bytes, " << elen << " bytes decompressed." << std::endl;
-			Debug(ss.str().c_str());
-			dest_it += elen;
+			size_t dlen = LZ77::Decode(src, count, &(*dest_it), elen);
+			LOG_TRACE(Log::CAT_SPRITE, "Copy " << elen << " compressed bytes, " << dlen << " bytes decompressed.");
+			src += elen;
+			dest_it += dlen;
 		}
 		else
 		{
-			std::ostringstream ss;
-			ss << "Copy " << count << " words directly." << std::endl;
-			Debug(ss.str().c_str());
+			LOG_TRACE(Log::CAT_SPRITE, "Copy " << count << " words directly.");
 			std::copy(src, src + count * 2, dest_it);
 			dest_it += count * 2;
 			src += count * 2;
@@ -67,6 +61,200 @@ SpriteFrame::SpriteFrame(const uint8_t* src)
 	} while ((ctrl & 0x04) == 0);
 
 	m_sprite_gfx.setBits(sprite_gfx.data(), tile_idx);
+	m_compressed_size = src - start;
+	m_uncompressed_size = sprite_gfx.size();
 
-	Debug("Done!");
-}
\ No newline at end of file
+	LOG_TRACE(Log::CAT_SPRITE, "Done!");
+}
+
+size_t SpriteFrame::GetCompressedSize() const
+{
+	return m_compressed_size;
+}
+
+size_t SpriteFrame::GetUncompressedSize() const
+{
+	return m_uncompressed_size;
+}
+
+SpriteFrame::Bounds SpriteFrame::GetBounds() const
+{
+	return GetBounds(m_subsprites);
+}
+
+SpriteFrame::Bounds SpriteFrame::GetBounds(const std::vector<SubSprite>& subsprites)
+{
+	if (subsprites.empty())
+	{
+		return Bounds{ 0, 0, 0, 0 };
+	}
+	int left = 0x7FFF;
+	int top = 0x7FFF;
+	int right = -0x7FFF;
+	int bottom = -0x7FFF;
+	for (const auto& subs : subsprites)
+	{
+		left   = std::min(left,   SubSpriteOffset(subs.x));
+		top    = std::min(top,    SubSpriteOffset(subs.y));
+		right  = std::max(right,  SubSpriteOffset(subs.x) + static_cast<int>(subs.w * 8));
+		bottom = std::max(bottom, SubSpriteOffset(subs.y) + static_cast<int>(subs.h * 8));
+	}
+	return Bounds{ left, top, static_cast<size_t>(right - left), static_cast<size_t>(bottom - top) };
+}
+
+int SpriteFrame::SubSpriteOffset(size_t coord)
+{
+	// Subsprite positions are stored as signed 8-bit offsets
+	return static_cast<int>((coord + 0x80) & 0xFF) - 0x80;
+}
+
+namespace
+{
+	// Graphics stream command nibbles, as tested by the decoder above
+	const uint16_t CMD_ZERO_RUN = 0x8000;
+	const uint16_t CMD_END      = 0x4000;
+	const uint16_t CMD_LZ77     = 0x2000;
+	const uint16_t CMD_RAW      = 0x0000;
+	const size_t MAX_COUNT = 0xFFF;
+	// Longest stretch of words between two candidate chunk boundaries
+	const size_t MAX_SPAN = 0x800;
+	// How many candidate boundaries back a single chunk may reach
+	const size_t MAX_LOOKBACK = 8;
+
+	struct Chunk
+	{
+		uint16_t command;
+		std::vector<uint8_t> payload;
+	};
+
+	bool IsZeroSpan(const uint8_t* words, size_t begin, size_t end)
+	{
+		return std::all_of(words + begin * 2, words + end * 2, [](uint8_t b) { return b == 0; });
+	}
+
+	std::vector<size_t> FindBoundaries(const uint8_t* words, size_t count)
+	{
+		// Chunks may start or end at either edge of a run of two or more
+		// zero words, and long stretches are split so counts fit in 12 bits
+		std::vector<size_t> boundaries(1, 0);
+		size_t i = 0;
+		while (i < count)
+		{
+			size_t j = i;
+			while ((j < count) && (words[j * 2] == 0) && (words[j * 2 + 1] == 0))
+			{
+				++j;
+			}
+			if (j - i >= 2)
+			{
+				boundaries.push_back(i);
+				boundaries.push_back(j);
+			}
+			i = (j > i) ? j : i + 1;
+		}
+		boundaries.push_back(count);
+		std::sort(boundaries.begin(), boundaries.end());
+		boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+		std::vector<size_t> split;
+		for (size_t b = 0; b < boundaries.size(); ++b)
+		{
+			if (b > 0)
+			{
+				for (size_t p = split.back() + MAX_SPAN; p < boundaries[b]; p += MAX_SPAN)
+				{
+					split.push_back(p);
+				}
+			}
+			split.push_back(boundaries[b]);
+		}
+		return split;
+	}
+
+	Chunk BestChunk(const uint8_t* words, size_t begin, size_t end)
+	{
+		const size_t count = end - begin;
+		Chunk best{ static_cast<uint16_t>(CMD_RAW | count), std::vector<uint8_t>(words + begin * 2, words + end * 2) };
+		if (IsZeroSpan(words, begin, end))
+		{
+			best.command = static_cast<uint16_t>(CMD_ZERO_RUN | count);
+			best.payload.clear();
+		}
+		else
+		{
+			std::vector<uint8_t> lz(count * 2 * 9 / 8 + 16);
+			size_t lz_size = LZ77::Encode(words + begin * 2, count * 2, lz.data());
+			if ((lz_size < best.payload.size()) && (lz_size <= MAX_COUNT))
+			{
+				lz.resize(lz_size);
+				best.command = static_cast<uint16_t>(CMD_LZ77 | lz_size);
+				best.payload.swap(lz);
+			}
+		}
+		return best;
+	}
+}
+
+std::vector<uint8_t> SpriteFrame::Encode() const
+{
+	std::vector<uint8_t> out;
+	for (size_t i = 0; i < m_subsprites.size(); ++i)
+	{
+		const SubSprite& subs = m_subsprites[i];
+		const bool last = (i + 1 == m_subsprites.size());
+		out.push_back(static_cast<uint8_t>(((subs.y >> 1) & 0x7C) | ((subs.w - 1) & 0x03)));
+		out.push_back(static_cast<uint8_t>(((subs.x >> 1) & 0x7C) | ((subs.h - 1) & 0x03) | (last ? 0x80 : 0x00)));
+	}
+
+	// Shortest-path over the candidate boundaries: each edge is one chunk,
+	// encoded as whichever of a zero run, raw copy or LZ77 block is smallest
+	const std::vector<uint8_t> gfx = m_sprite_gfx.getBits();
+	const size_t word_count = gfx.size() / 2;
+	const std::vector<size_t> bounds = FindBoundaries(gfx.data(), word_count);
+	std::vector<size_t> cost(bounds.size(), static_cast<size_t>(-1));
+	std::vector<size_t> from(bounds.size(), 0);
+	std::vector<Chunk> chunk(bounds.size());
+	cost[0] = 0;
+	for (size_t j = 1; j < bounds.size(); ++j)
+	{
+		for (size_t i = (j > MAX_LOOKBACK) ? j - MAX_LOOKBACK : 0; i < j; ++i)
+		{
+			if ((bounds[j] - bounds[i] > MAX_COUNT) || (cost[i] == static_cast<size_t>(-1)))
+			{
+				continue;
+			}
+			Chunk c = BestChunk(gfx.data(), bounds[i], bounds[j]);
+			const size_t total = cost[i] + 2 + c.payload.size();
+			if (total < cost[j])
+			{
+				cost[j] = total;
+				from[j] = i;
+				chunk[j] = std::move(c);
+			}
+		}
+	}
+
+	std::vector<size_t> path;
+	for (size_t j = bounds.size() - 1; j > 0; j = from[j])
+	{
+		path.push_back(j);
+	}
+	if (path.empty())
+	{
+		// No graphics: a single empty raw copy carries the end flag
+		out.push_back(CMD_END >> 8);
+		out.push_back(0x00);
+		return out;
+	}
+	for (auto it = path.rbegin(); it != path.rend(); ++it)
+	{
+		uint16_t command = chunk[*it].command;
+		if (*it == bounds.size() - 1)
+		{
+			command |= CMD_END;
+		}
+		out.push_back(command >> 8);
+		out.push_back(command & 0xFF);
+		out.insert(out.end(), chunk[*it].payload.begin(), chunk[*it].payload.end());
+	}
+	return out;
+}
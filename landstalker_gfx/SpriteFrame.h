@@ -17,10 +17,29 @@ public:
 		size_t tile_idx;
 	};
 
+	// Bounding box of all subsprites, relative to the sprite's origin
+	struct Bounds
+	{
+		int left;
+		int top;
+		size_t width;
+		size_t height;
+	};
+
 	SpriteFrame(const uint8_t* src);
 
+	size_t GetCompressedSize() const;
+	size_t GetUncompressedSize() const;
+	Bounds GetBounds() const;
+	static Bounds GetBounds(const std::vector<SubSprite>& subsprites);
+	std::vector<uint8_t> Encode() const;
+	static int SubSpriteOffset(size_t coord);
+
 	std::vector<SubSprite> m_subsprites;
 	Tileset m_sprite_gfx;
+private:
+	size_t m_compressed_size;
+	size_t m_uncompressed_size;
 };
 
 #endif // SPRITE_FRAME_H
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "SpriteFrameStore.h"
+
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+
+SpriteFrameStore::SpriteFrameStore(size_t max_resident)
+	: m_rom(nullptr), m_cache(max_resident)
+{
+}
+
+void SpriteFrameStore::Init(const Rom& rom, const std::vector<uint32_t>& offsets)
+{
+	m_cache.Clear();
+	m_tiles.reset();
+	m_rom = &rom;
+	m_offsets = offsets;
+}
+
+void SpriteFrameStore::Clear()
+{
+	m_cache.Clear();
+	m_tiles.reset();
+	m_offsets.clear();
+	m_rom = nullptr;
+}
+
+std::shared_ptr<const SpriteFrame> SpriteFrameStore::Get(size_t index) const
+{
+	if ((m_rom == nullptr) || (index >= m_offsets.size()))
+	{
+		std::ostringstream ss;
+		ss << "Attempt to obtain out-of-range sprite frame " << index;
+		throw std::runtime_error(ss.str());
+	}
+	auto frame = m_cache.Find(index);
+	if (frame == nullptr)
+	{
+		frame = std::make_shared<const SpriteFrame>(m_rom->data(m_offsets[index]));
+		m_cache.Insert(index, frame);
+	}
+	return frame;
+}
+
+std::vector<std::shared_ptr<const SpriteFrame>> SpriteFrameStore::DecodeAll(ThreadPool& pool, std::vector<DecodeStats>* stats) const
+{
+	// Every frame is decoded into its own slot, so the output order matches
+	// the frame table regardless of which worker finishes first. Frames
+	// decoded here bypass the cache: a full decode would only flush it.
+	std::vector<std::shared_ptr<const SpriteFrame>> frames(m_offsets.size());
+	std::vector<DecodeStats> frame_stats(m_offsets.size());
+	if (m_rom != nullptr)
+	{
+		const Rom& rom = *m_rom;
+		pool.ParallelFor(m_offsets.size(), [&](size_t i)
+		{
+			// A frame that fails to decode is left empty, so one bad frame
+			// doesn't cost the rest of the table
+			frame_stats[i] = DecodeStats{ m_offsets[i], 0, 0, 0.0 };
+			auto start = std::chrono::steady_clock::now();
+			try
+			{
+				frames[i] = std::make_shared<const SpriteFrame>(rom.data(m_offsets[i]));
+			}
+			catch (const std::exception&)
+			{
+				return;
+			}
+			auto end = std::chrono::steady_clock::now();
+			frame_stats[i].compressed_size = frames[i]->GetCompressedSize();
+			frame_stats[i].uncompressed_size = frames[i]->GetUncompressedSize();
+			frame_stats[i].decode_time_us = std::chrono::duration<double, std::micro>(end - start).count();
+		});
+	}
+	if (stats != nullptr)
+	{
+		stats->swap(frame_stats);
+	}
+	return frames;
+}
+
+SpriteFrameStore::EncoderReport SpriteFrameStore::VerifyEncoder(ThreadPool& pool) const
+{
+	// Checks every frame in the ROM survives re-encoding
+	std::vector<size_t> encoded_size(m_offsets.size(), 0);
+	std::vector<size_t> original_size(m_offsets.size(), 0);
+	std::vector<char> matches(m_offsets.size(), 0);
+	if (m_rom != nullptr)
+	{
+		const Rom& rom = *m_rom;
+		pool.ParallelFor(m_offsets.size(), [&](size_t i)
+		{
+			// A frame that fails to decode or encode counts as a mismatch
+			try
+			{
+				matches[i] = VerifyFrame(rom.data(m_offsets[i]), original_size[i], encoded_size[i]);
+			}
+			catch (const std::exception&)
+			{
+				matches[i] = 0;
+			}
+		});
+	}
+
+	EncoderReport report{ m_offsets.size(), 0, 0, 0, 0, {} };
+	for (size_t i = 0; i < m_offsets.size(); ++i)
+	{
+		report.original_bytes += original_size[i];
+		report.encoded_bytes += encoded_size[i];
+		report.smaller += (encoded_size[i] < original_size[i]) ? 1 : 0;
+		report.larger += (encoded_size[i] > original_size[i]) ? 1 : 0;
+		if (!matches[i])
+		{
+			report.mismatched_frames.push_back(i);
+		}
+	}
+	return report;
+}
+
+// Re-encodes one frame and decodes it again, returning whether its subsprites
+// and graphics survive unchanged
+bool SpriteFrameStore::VerifyFrame(const uint8_t* src, size_t& original_size, size_t& encoded_size)
+{
+	const SpriteFrame original(src);
+	const std::vector<uint8_t> encoded = original.Encode();
+	const SpriteFrame decoded(encoded.data());
+	bool match = (decoded.m_subsprites.size() == original.m_subsprites.size()) &&
+	             (decoded.m_sprite_gfx.getBits() == original.m_sprite_gfx.getBits());
+	for (size_t s = 0; match && (s < original.m_subsprites.size()); ++s)
+	{
+		const SpriteFrame::SubSprite& a = original.m_subsprites[s];
+		const SpriteFrame::SubSprite& b = decoded.m_subsprites[s];
+		match = (a.x == b.x) && (a.y == b.y) && (a.w == b.w) && (a.h == b.h) && (a.tile_idx == b.tile_idx);
+	}
+	original_size = original.GetCompressedSize();
+	encoded_size = encoded.size();
+	return match;
+}
+
+// Decodes every frame in turn, pools their tiles and drops the decoded
+// frames. It all runs on the calling thread, so a single background task
+// builds it without holding up the rest of the pool, and cancelled() is
+// checked between frames: once it returns true the build is abandoned and
+// null is returned. The store is built without touching this one, so it can
+// be handed over with SetSharedTiles() when done.
+std::shared_ptr<const SpriteTileStore> SpriteFrameStore::BuildSharedTiles(const std::function<bool()>& cancelled) const
+{
+	std::vector<std::shared_ptr<const SpriteFrame>> frames(m_offsets.size());
+	for (size_t i = 0; (m_rom != nullptr) && (i < m_offsets.size()); ++i)
+	{
+		if (cancelled())
+		{
+			return nullptr;
+		}
+		// As in DecodeAll, a frame that fails to decode is left empty
+		try
+		{
+			frames[i] = std::make_shared<const SpriteFrame>(m_rom->data(m_offsets[i]));
+		}
+		catch (const std::exception&)
+		{
+		}
+	}
+	if (cancelled())
+	{
+		return nullptr;
+	}
+	auto tiles = std::make_shared<SpriteTileStore>();
+	tiles->Build(frames);
+	return tiles;
+}
+
+void SpriteFrameStore::SetSharedTiles(const std::shared_ptr<const SpriteTileStore>& tiles)
+{
+	m_tiles = tiles;
+}
+
+std::shared_ptr<const SpriteTileStore> SpriteFrameStore::GetSharedTiles() const
+{
+	return m_tiles;
+}
+
+uint32_t SpriteFrameStore::GetOffset(size_t index) const
+{
+	return m_offsets[index];
+}
+
+size_t SpriteFrameStore::size() const
+{
+	return m_offsets.size();
+}
+
+size_t SpriteFrameStore::GetResidentCount() const
+{
+	return m_cache.Size();
+}
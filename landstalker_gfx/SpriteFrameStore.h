@@ -0,0 +1,63 @@
+#ifndef SPRITE_FRAME_STORE_H
+#define SPRITE_FRAME_STORE_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Rom.h"
+#include "SpriteFrame.h"
+#include "LruCache.h"
+#include "SpriteTileStore.h"
+#include "ThreadPool.h"
+
+// Holds the ROM offsets of every sprite frame, and decodes frames on demand.
+// Only the most recently used frames are kept resident. Every frame can also
+// be kept in a shared tile store, where frames take a fraction of the memory
+// of their decoded form and can be drawn without decoding.
+class SpriteFrameStore
+{
+public:
+	static const size_t DEFAULT_RESIDENT_FRAMES = 256;
+
+	struct DecodeStats
+	{
+		uint32_t offset;
+		size_t compressed_size;
+		size_t uncompressed_size;
+		double decode_time_us;
+	};
+
+	struct EncoderReport
+	{
+		size_t frames;
+		size_t original_bytes;
+		size_t encoded_bytes;
+		size_t smaller;
+		size_t larger;
+		std::vector<size_t> mismatched_frames;
+	};
+
+	SpriteFrameStore(size_t max_resident = DEFAULT_RESIDENT_FRAMES);
+
+	void Init(const Rom& rom, const std::vector<uint32_t>& offsets);
+	void Clear();
+	std::shared_ptr<const SpriteFrame> Get(size_t index) const;
+	std::vector<std::shared_ptr<const SpriteFrame>> DecodeAll(ThreadPool& pool, std::vector<DecodeStats>* stats = nullptr) const;
+	EncoderReport VerifyEncoder(ThreadPool& pool) const;
+	std::shared_ptr<const SpriteTileStore> BuildSharedTiles(const std::function<bool()>& cancelled) const;
+	void SetSharedTiles(const std::shared_ptr<const SpriteTileStore>& tiles);
+	std::shared_ptr<const SpriteTileStore> GetSharedTiles() const;
+	uint32_t GetOffset(size_t index) const;
+	size_t size() const;
+	size_t GetResidentCount() const;
+private:
+	static bool VerifyFrame(const uint8_t* src, size_t& original_size, size_t& encoded_size);
+
+	const Rom* m_rom;
+	std::vector<uint32_t> m_offsets;
+	mutable LruCache<size_t, SpriteFrame> m_cache;
+	std::shared_ptr<const SpriteTileStore> m_tiles;
+};
+
+#endif // SPRITE_FRAME_STORE_H
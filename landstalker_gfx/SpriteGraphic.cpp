@@ -1,28 +1,29 @@
 #include "SpriteGraphic.h"
 
 SpriteGraphic::SpriteGraphic(size_t index)
-: m_index(index)
+: m_index(index), m_animation_start(1, 0)
 {
 }
 
 void SpriteGraphic::AddAnimation(const std::vector<uint32_t>& frame_list)
 {
-	m_animation_frames.push_back(frame_list);
+	m_frames.insert(m_frames.end(), frame_list.cbegin(), frame_list.cend());
+	m_animation_start.push_back(m_frames.size());
 }
 
 const size_t SpriteGraphic::RetrieveFrameIdx(size_t animation, size_t frame) const
 {
-	return m_animation_frames[animation][frame];
+	return m_frames[m_animation_start[animation] + frame];
 }
 
 const size_t SpriteGraphic::GetAnimationCount() const
 {
-	return m_animation_frames.size();
+	return m_animation_start.size() - 1;
 }
 
 const size_t SpriteGraphic::GetFrameCount(size_t animation) const
 {
-	return m_animation_frames[animation].size();
+	return m_animation_start[animation + 1] - m_animation_start[animation];
 }
 
 const size_t SpriteGraphic::GetIndex() const
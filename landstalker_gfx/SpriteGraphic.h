@@ -2,6 +2,7 @@
 #define SPRITE_GRAPHIC_H
 
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
 class SpriteGraphic
@@ -15,7 +16,10 @@ public:
 	const size_t GetIndex() const;
 private:
 	size_t m_index;
-	std::vector< std::vector< uint32_t > > m_animation_frames;
+	// Frame lists of all animations stored back to back. Animation n occupies
+	// m_frames[m_animation_start[n]] up to m_frames[m_animation_start[n + 1]].
+	std::vector<uint32_t> m_animation_start;
+	std::vector<uint32_t> m_frames;
 };
 
 #endif // SPRITE_GRAPHIC_H
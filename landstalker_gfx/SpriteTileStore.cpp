@@ -0,0 +1,210 @@
+#include "SpriteTileStore.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+struct CanonicalTile
+{
+	std::string canonical;
+	std::string exact;
+	uint8_t flip;
+};
+
+// Of the four flipped variants of a tile, the lexicographically smallest is
+// used as the stored copy, so that all mirror images map to the same key.
+CanonicalTile Canonicalise(const uint8_t* pixels)
+{
+	CanonicalTile ret;
+	ret.exact.assign(pixels, pixels + SpriteTileStore::TILE_SIZE);
+	ret.canonical = ret.exact;
+	ret.flip = SpriteTileStore::FLIP_NONE;
+	std::string variant(SpriteTileStore::TILE_SIZE, '\0');
+	for (uint8_t flip = SpriteTileStore::FLIP_H; flip <= SpriteTileStore::FLIP_HV; ++flip)
+	{
+		SpriteTileStore::FlipTile(pixels, reinterpret_cast<uint8_t*>(&variant[0]), flip);
+		if (variant < ret.canonical)
+		{
+			ret.canonical = variant;
+			ret.flip = flip;
+		}
+	}
+	return ret;
+}
+}
+
+SpriteTileStore::SpriteTileStore()
+	: m_frame_start(1, 0), m_report()
+{
+}
+
+void SpriteTileStore::Build(const std::vector<std::shared_ptr<const SpriteFrame>>& frames, ThreadPool& pool)
+{
+	BuildFrom(frames, &pool);
+}
+
+// As above, but entirely on the calling thread, for a background build that
+// shouldn't take the other workers away from more urgent tasks
+void SpriteTileStore::Build(const std::vector<std::shared_ptr<const SpriteFrame>>& frames)
+{
+	BuildFrom(frames, nullptr);
+}
+
+void SpriteTileStore::BuildFrom(const std::vector<std::shared_ptr<const SpriteFrame>>& frames, ThreadPool* pool)
+{
+	Clear();
+
+	// Canonicalising is independent per frame, so it is spread over the
+	// pool. Assigning ids is done in frame order so that they are stable.
+	std::vector<std::vector<CanonicalTile>> canonical(frames.size());
+	m_layouts.assign(frames.size(), std::vector<SpriteFrame::SubSprite>());
+	auto canonicalise = [&](size_t i)
+	{
+		if (frames[i] == nullptr)
+		{
+			return;
+		}
+		m_layouts[i] = frames[i]->m_subsprites;
+		const Tileset& tiles = frames[i]->m_sprite_gfx;
+		canonical[i].reserve(tiles.size());
+		for (size_t t = 0; t < tiles.size(); ++t)
+		{
+			canonical[i].push_back(Canonicalise(tiles.getTilePixels(t)));
+		}
+	};
+	if (pool != nullptr)
+	{
+		pool->ParallelFor(frames.size(), canonicalise);
+	}
+	else
+	{
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			canonicalise(i);
+		}
+	}
+
+	std::unordered_map<std::string, uint32_t> ids;
+	std::unordered_set<std::string> exact;
+	const std::string blank(TILE_SIZE, '\0');
+	for (const auto& frame_tiles : canonical)
+	{
+		for (const auto& tile : frame_tiles)
+		{
+			auto result = ids.insert(std::make_pair(tile.canonical, static_cast<uint32_t>(ids.size())));
+			if (result.second)
+			{
+				m_pixels.insert(m_pixels.end(), tile.canonical.cbegin(), tile.canonical.cend());
+			}
+			m_refs.push_back({ result.first->second, tile.flip });
+			exact.insert(tile.exact);
+			if (tile.exact == blank)
+			{
+				m_report.blank_tiles++;
+			}
+		}
+		m_frame_start.push_back(m_refs.size());
+	}
+
+	// Byte counts are for 4bpp tile data, as stored in the ROM
+	m_report.frames = frames.size();
+	m_report.tiles = m_refs.size();
+	m_report.unique_exact = exact.size();
+	m_report.unique_with_flips = ids.size();
+	m_report.original_bytes = m_report.tiles * TILE_SIZE / 2;
+	m_report.stored_bytes = m_report.unique_with_flips * TILE_SIZE / 2;
+}
+
+void SpriteTileStore::Clear()
+{
+	m_frame_start.assign(1, 0);
+	m_refs.clear();
+	m_layouts.clear();
+	m_pixels.clear();
+	m_report = Report();
+}
+
+size_t SpriteTileStore::GetFrameCount() const
+{
+	return m_frame_start.size() - 1;
+}
+
+size_t SpriteTileStore::GetFrameTileCount(size_t frame) const
+{
+	return m_frame_start[frame + 1] - m_frame_start[frame];
+}
+
+SpriteTileStore::TileRef SpriteTileStore::GetTileRef(size_t frame, size_t tile) const
+{
+	if ((frame >= GetFrameCount()) || (tile >= GetFrameTileCount(frame)))
+	{
+		std::ostringstream ss;
+		ss << "Attempt to obtain out-of-range sprite tile " << tile << " of frame " << frame;
+		throw std::runtime_error(ss.str());
+	}
+	return m_refs[m_frame_start[frame] + tile];
+}
+
+const std::vector<SpriteFrame::SubSprite>& SpriteTileStore::GetSubSprites(size_t frame) const
+{
+	if (frame >= GetFrameCount())
+	{
+		std::ostringstream ss;
+		ss << "Attempt to obtain out-of-range sprite frame " << frame << " from the tile store";
+		throw std::runtime_error(ss.str());
+	}
+	return m_layouts[frame];
+}
+
+const uint8_t* SpriteTileStore::GetTilePixels(uint32_t id) const
+{
+	if (id >= GetUniqueTileCount())
+	{
+		std::ostringstream ss;
+		ss << "Attempt to obtain out-of-range shared sprite tile " << id;
+		throw std::runtime_error(ss.str());
+	}
+	return m_pixels.data() + id * TILE_SIZE;
+}
+
+std::vector<uint8_t> SpriteTileStore::GetTile(size_t frame, size_t tile) const
+{
+	const TileRef ref = GetTileRef(frame, tile);
+	std::vector<uint8_t> ret(TILE_SIZE);
+	FlipTile(GetTilePixels(ref.id), ret.data(), ref.flip);
+	return ret;
+}
+
+size_t SpriteTileStore::GetUniqueTileCount() const
+{
+	return m_pixels.size() / TILE_SIZE;
+}
+
+const SpriteTileStore::Report& SpriteTileStore::GetReport() const
+{
+	return m_report;
+}
+
+// Flips are their own inverse, so the same call both canonicalises a tile
+// and restores it from the stored copy.
+void SpriteTileStore::FlipTile(const uint8_t* src, uint8_t* dest, uint8_t flip)
+{
+	for (size_t y = 0; y < TILE_HEIGHT; ++y)
+	{
+		const uint8_t* src_row = src + TILE_WIDTH * ((flip & FLIP_V) ? (TILE_HEIGHT - 1 - y) : y);
+		uint8_t* dest_row = dest + TILE_WIDTH * y;
+		if (flip & FLIP_H)
+		{
+			std::reverse_copy(src_row, src_row + TILE_WIDTH, dest_row);
+		}
+		else
+		{
+			std::copy(src_row, src_row + TILE_WIDTH, dest_row);
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef SPRITE_TILE_STORE_H
+#define SPRITE_TILE_STORE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "SpriteFrame.h"
+#include "ThreadPool.h"
+
+// Pools the 8x8 tiles of many sprite frames, keeping one copy of each
+// distinct tile. Tiles that are mirror images of each other share a single
+// entry: each frame tile refers to a stored tile plus the flips needed to
+// reproduce it. The subsprite layout of each frame is kept too, so any frame
+// can be drawn from the store once the decoded frames have been dropped.
+class SpriteTileStore
+{
+public:
+	enum Flip : uint8_t
+	{
+		FLIP_NONE = 0,
+		FLIP_H = 1,
+		FLIP_V = 2,
+		FLIP_HV = FLIP_H | FLIP_V
+	};
+
+	struct TileRef
+	{
+		uint32_t id;
+		uint8_t flip;
+	};
+
+	struct Report
+	{
+		size_t frames;
+		size_t tiles;
+		size_t blank_tiles;
+		size_t unique_exact;
+		size_t unique_with_flips;
+		size_t original_bytes;
+		size_t stored_bytes;
+	};
+
+	static const size_t TILE_WIDTH = 8;
+	static const size_t TILE_HEIGHT = 8;
+	static const size_t TILE_SIZE = TILE_WIDTH * TILE_HEIGHT;
+
+	SpriteTileStore();
+
+	void Build(const std::vector<std::shared_ptr<const SpriteFrame>>& frames, ThreadPool& pool);
+	void Build(const std::vector<std::shared_ptr<const SpriteFrame>>& frames);
+	void Clear();
+	size_t GetFrameCount() const;
+	size_t GetFrameTileCount(size_t frame) const;
+	TileRef GetTileRef(size_t frame, size_t tile) const;
+	const std::vector<SpriteFrame::SubSprite>& GetSubSprites(size_t frame) const;
+	const uint8_t* GetTilePixels(uint32_t id) const;
+	std::vector<uint8_t> GetTile(size_t frame, size_t tile) const;
+	size_t GetUniqueTileCount() const;
+	const Report& GetReport() const;
+
+	static void FlipTile(const uint8_t* src, uint8_t* dest, uint8_t flip);
+private:
+	void BuildFrom(const std::vector<std::shared_ptr<const SpriteFrame>>& frames, ThreadPool* pool);
+
+	// Frame n's tile references are m_refs[m_frame_start[n]] up to
+	// m_refs[m_frame_start[n + 1]]
+	std::vector<uint32_t> m_frame_start;
+	std::vector<TileRef> m_refs;
+	std::vector<std::vector<SpriteFrame::SubSprite>> m_layouts;
+	std::vector<uint8_t> m_pixels;
+	Report m_report;
+};
+
+#endif // SPRITE_TILE_STORE_H
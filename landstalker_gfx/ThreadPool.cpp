@@ -0,0 +1,239 @@
+#include "ThreadPool.h"
+
+#include <stdexcept>
+
+namespace
+{
+	// Identifies the pool and queue owned by the current thread, so that tasks
+	// spawned by a worker stay local to it.
+	thread_local const ThreadPool* tl_pool = nullptr;
+	thread_local size_t tl_queue = 0;
+}
+
+ThreadPool::ThreadPool(size_t workers)
+	: m_queued(0), m_pending(0), m_helpers(0), m_next_queue(0), m_stop(false),
+	  m_detached(std::make_shared<Batch>())
+{
+	if (workers == 0)
+	{
+		workers = DefaultWorkerCount();
+	}
+	for (size_t i = 0; i < workers; ++i)
+	{
+		m_queues.emplace_back(new WorkQueue());
+	}
+	for (size_t i = 0; i < workers; ++i)
+	{
+		m_workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_work_available.notify_all();
+	for (auto& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Submit(Task task)
+{
+	Enqueue(std::move(task), m_detached);
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& fn)
+{
+	Batch batch;
+	// The batch outlives its tasks because this call waits for all of them,
+	// so the jobs can share it without owning it.
+	std::shared_ptr<Batch> handle(&batch, [](Batch*) {});
+	for (size_t i = 0; i < count; ++i)
+	{
+		Enqueue([&fn, i]() { fn(i); }, handle);
+	}
+	WaitForBatch(batch);
+}
+
+void ThreadPool::Wait()
+{
+	if (tl_pool == this)
+	{
+		throw std::logic_error("ThreadPool::Wait() called from a pool task.");
+	}
+	std::exception_ptr error;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_all_done.wait(lock, [this]() { return m_pending == 0; });
+		std::swap(error, m_detached->error);
+	}
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+void ThreadPool::Enqueue(Task task, const std::shared_ptr<Batch>& batch)
+{
+	size_t queue;
+	bool wake_helpers;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		queue = (tl_pool == this) ? tl_queue : (m_next_queue++ % m_queues.size());
+		// Counted before the task is visible, so a worker that takes it can
+		// never see the count drop below zero.
+		++batch->pending;
+		++m_pending;
+		++m_queued;
+		wake_helpers = (m_helpers > 0);
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+		m_queues[queue]->jobs.push_back(Job{ std::move(task), batch });
+	}
+	m_work_available.notify_one();
+	if (wake_helpers)
+	{
+		m_all_done.notify_all();
+	}
+}
+
+void ThreadPool::WaitForBatch(Batch& batch)
+{
+	const bool is_worker = (tl_pool == this);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (batch.pending > 0)
+	{
+		if (is_worker && (m_queued > 0))
+		{
+			// Blocking here would hold a worker hostage, and with every
+			// worker waiting nothing would run, so help out instead
+			lock.unlock();
+			Job job;
+			if (TakeTask(tl_queue, job))
+			{
+				RunTask(job);
+			}
+			lock.lock();
+			continue;
+		}
+		if (is_worker)
+		{
+			++m_helpers;
+		}
+		m_all_done.wait(lock);
+		if (is_worker)
+		{
+			--m_helpers;
+		}
+	}
+	std::exception_ptr error;
+	std::swap(error, batch.error);
+	lock.unlock();
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+size_t ThreadPool::GetWorkerCount() const
+{
+	return m_workers.size();
+}
+
+size_t ThreadPool::DefaultWorkerCount()
+{
+	size_t count = std::thread::hardware_concurrency();
+	return (count > 0) ? count : 1;
+}
+
+void ThreadPool::WorkerLoop(size_t index)
+{
+	tl_pool = this;
+	tl_queue = index;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_work_available.wait(lock, [this]() { return m_stop || (m_queued > 0); });
+			if (m_stop)
+			{
+				break;
+			}
+		}
+		Job job;
+		if (TakeTask(index, job))
+		{
+			RunTask(job);
+		}
+	}
+	tl_pool = nullptr;
+}
+
+bool ThreadPool::TakeTask(size_t index, Job& job)
+{
+	bool found = false;
+	{
+		WorkQueue& own = *m_queues[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty())
+		{
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			found = true;
+		}
+	}
+	for (size_t i = 1; !found && (i < m_queues.size()); ++i)
+	{
+		WorkQueue& victim = *m_queues[(index + i) % m_queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			found = true;
+		}
+	}
+	if (found)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		--m_queued;
+	}
+	return found;
+}
+
+void ThreadPool::RunTask(Job& job)
+{
+	std::exception_ptr error;
+	try
+	{
+		job.task();
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+	// Captures are released before the batch is marked done, as ParallelFor
+	// may return and free what they refer to as soon as it is
+	job.task = nullptr;
+	bool done;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Batch& batch = *job.batch;
+		if (error && !batch.error)
+		{
+			batch.error = error;
+		}
+		--m_pending;
+		done = (--batch.pending == 0) || (m_pending == 0);
+		job.batch.reset();
+	}
+	if (done)
+	{
+		m_all_done.notify_all();
+	}
+}
@@ -0,0 +1,84 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size work-stealing thread pool. Every worker owns a task deque: it
+// takes work from the back of its own deque, and when that runs dry it steals
+// from the front of the other workers' deques. Tasks submitted from inside a
+// worker go onto that worker's deque; tasks submitted from outside the pool
+// are distributed round-robin.
+//
+// ParallelFor tracks its own batch of tasks: it waits only for those, and
+// rethrows only their first exception. A worker that calls ParallelFor runs
+// queued tasks while it waits rather than blocking. Wait() drains the whole
+// pool and rethrows the first exception from a task given to Submit(); it
+// must not be called from a pool task, since that task is itself pending.
+class ThreadPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	explicit ThreadPool(size_t workers = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Submit(Task task);
+	void ParallelFor(size_t count, const std::function<void(size_t)>& fn);
+	void Wait();
+	size_t GetWorkerCount() const;
+
+	static size_t DefaultWorkerCount();
+private:
+	struct Batch
+	{
+		Batch() : pending(0) {}
+
+		size_t pending;
+		std::exception_ptr error;
+	};
+
+	struct Job
+	{
+		Task task;
+		std::shared_ptr<Batch> batch;
+	};
+
+	struct WorkQueue
+	{
+		std::deque<Job> jobs;
+		std::mutex mutex;
+	};
+
+	void Enqueue(Task task, const std::shared_ptr<Batch>& batch);
+	void WaitForBatch(Batch& batch);
+	void WorkerLoop(size_t index);
+	bool TakeTask(size_t index, Job& job);
+	void RunTask(Job& job);
+
+	std::vector<std::unique_ptr<WorkQueue>> m_queues;
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_work_available;
+	std::condition_variable m_all_done;
+	size_t m_queued;
+	size_t m_pending;
+	size_t m_helpers;
+	size_t m_next_queue;
+	bool m_stop;
+	// Collects the tasks given to Submit(), whose errors Wait() rethrows
+	std::shared_ptr<Batch> m_detached;
+};
+
+#endif // THREAD_POOL_H
@@ -149,7 +149,7 @@ void Tilemap::Clear()
 	m_tilevals.resize(GetWidth() * GetHeight());
 }
 
-bool Tilemap::IsXYPointValid(const wxPoint& point) const
+bool Tilemap::IsXYPointValid(const Point& point) const
 {
 	bool retval = false;
 	TilePoint tilepoint(XYToTilePoint(point));
@@ -3,7 +3,7 @@
 
 #include <cstdint>
 #include <memory>
-#include <wx/gdicmn.h>
+#include "Geometry.h"
 
 #include "Tileset.h"
 #include "Palette.h"
@@ -36,14 +36,14 @@ public:
 	void Copy(const uint8_t* src, uint16_t base = 0);
 	void Copy(std::vector<uint16_t>::const_iterator begin, std::vector<uint16_t>::const_iterator end);
 	void Clear();
-	bool IsXYPointValid(const wxPoint& point) const;
+	bool IsXYPointValid(const Point& point) const;
 	bool WriteBinaryFile(const std::string& filename, bool include_dimensions);
 	bool WriteCSVFile(const std::string& filename);
 	bool ReadBinaryFile(const std::string& filename, bool dimensions_included);
 	bool ReadCSVFile(const std::string& filename);
 
-	virtual TilePoint XYToTilePoint(const wxPoint& point) const = 0;
-	virtual wxPoint ToXYPoint(const TilePoint& point) const = 0;
+	virtual TilePoint XYToTilePoint(const Point& point) const = 0;
+	virtual Point ToXYPoint(const TilePoint& point) const = 0;
 	virtual void Draw(ImageBuffer& imgbuf) const = 0;
 	virtual size_t GetBitmapWidth() const = 0;
 	virtual size_t GetBitmapHeight() const = 0;
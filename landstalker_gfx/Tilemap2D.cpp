@@ -5,29 +5,24 @@ Tilemap2D::Tilemap2D(size_t width, size_t height, size_t left, size_t top, uint8
 {
 }
 
-void Tilemap2D::SetTileset(std::shared_ptr<Tileset> tileset)
+void Tilemap2D::SetTileset(std::shared_ptr<const Tileset> tileset)
 {
 	m_tileset = tileset;
 }
 
-std::shared_ptr<Tileset> Tilemap2D::GetTileset()
-{
-	return m_tileset;
-}
-
 std::shared_ptr<const Tileset> Tilemap2D::GetTileset() const
 {
 	return m_tileset;
 }
 
-TilePoint Tilemap2D::XYToTilePoint(const wxPoint& point) const
+TilePoint Tilemap2D::XYToTilePoint(const Point& point) const
 {
 	return TilePoint({ (point.x - GetLeft()) / TILEWIDTH, (point.y - GetTop()) / TILEHEIGHT });
 }
 
-wxPoint Tilemap2D::ToXYPoint(const TilePoint& point) const
+Point Tilemap2D::ToXYPoint(const TilePoint& point) const
 {
-	return wxPoint(point.x * TILEWIDTH + GetLeft(), point.y * TILEHEIGHT + GetTop());
+	return Point(point.x * TILEWIDTH + GetLeft(), point.y * TILEHEIGHT + GetTop());
 }
 
 void Tilemap2D::Draw(ImageBuffer& imgbuf) const
@@ -35,7 +30,7 @@ void Tilemap2D::Draw(ImageBuffer& imgbuf) const
 	TilePoint tilepos{ 0,0 };
 	for (const auto& tile : m_tilevals)
 	{
-		wxPoint loc(ToXYPoint(tilepos));
+		Point loc(ToXYPoint(tilepos));
 		imgbuf.InsertTile(loc.x, loc.y, GetPalette(), Tile(tile), *GetTileset());
 		tilepos.x++;
 		if (tilepos.x == GetWidth())
@@ -11,11 +11,10 @@ class Tilemap2D : public Tilemap
 public:
 	Tilemap2D(size_t width, size_t height, size_t left, size_t top, uint8_t palette);
 	virtual ~Tilemap2D() = default;
-	virtual TilePoint XYToTilePoint(const wxPoint& point) const;
-	virtual wxPoint ToXYPoint(const TilePoint& point) const;
+	virtual TilePoint XYToTilePoint(const Point& point) const;
+	virtual Point ToXYPoint(const TilePoint& point) const;
 	virtual void Draw(ImageBuffer& imgbuf) const;
-	virtual void SetTileset(std::shared_ptr<Tileset> tileset);
-	virtual std::shared_ptr<Tileset> GetTileset();
+	virtual void SetTileset(std::shared_ptr<const Tileset> tileset);
 	virtual std::shared_ptr<const Tileset> GetTileset() const;
 	Tile GetTile(const TilePoint& point) const;
 	void SetTile(const TilePoint& point, const Tile& tile);
@@ -27,7 +26,7 @@ protected:
 	const size_t TILEHEIGHT = 8;
 
 private:
-	std::shared_ptr<Tileset> m_tileset;
+	std::shared_ptr<const Tileset> m_tileset;
 };
 
 #endif // TILEMAP2D_H
\ No newline at end of file
@@ -1,7 +1,6 @@
 #include "Tileset.h"
 #include <algorithm>
-#include <sstream>
-#include "Utils.h"
+#include "Log.h"
 
 Tileset::Tileset()
 {
@@ -13,29 +12,35 @@ Tileset::~Tileset()
 
 void Tileset::setBits(const uint8_t* src, size_t num_tiles)
 {
-    m_tiles.clear();
-    m_tiles.assign(num_tiles, std::vector<uint8_t>(WIDTH * HEIGHT));
-    for(auto& t : m_tiles)
+    m_pixels.resize(num_tiles * TILE_SIZE);
+    for (size_t i = 0; i < m_pixels.size(); i += 2)
     {
-        for (size_t i = 0; i < (WIDTH * HEIGHT / 2); ++i)
-        {
-            t[i * 2] = *src >> 4;
-            t[i * 2 + 1] = *src++ & 0x0F;
-        }
+        m_pixels[i] = *src >> 4;
+        m_pixels[i + 1] = *src++ & 0x0F;
+    }
+}
+
+std::vector<uint8_t> Tileset::getBits() const
+{
+    std::vector<uint8_t> bits;
+    bits.reserve(m_pixels.size() / 2);
+    for (size_t i = 0; i < m_pixels.size(); i += 2)
+    {
+        bits.push_back((m_pixels[i] << 4) | (m_pixels[i + 1] & 0x0F));
     }
+    return bits;
 }
 
 std::vector<uint8_t> Tileset::getTile(const Tile& tile) const
 {
     size_t idx = tile.GetIndex();
-    if (idx >= m_tiles.size())
+    if (idx >= size())
     {
-        std::ostringstream ss;
-        ss << "Attempt to obtain out-of-range tile " << idx;
-        Debug(ss.str());
+        LOG_WARNING(Log::CAT_TILESET, "Attempt to obtain out-of-range tile " << idx);
         idx = 0;
     }
-    std::vector<uint8_t> ret(m_tiles[idx]);
+    auto tile_it = m_pixels.cbegin() + idx * TILE_SIZE;
+    std::vector<uint8_t> ret(tile_it, tile_it + TILE_SIZE);
     if (tile.Attributes().getAttribute(TileAttributes::ATTR_VFLIP))
     {
         for (size_t i = 0; i < HEIGHT/2; ++i)
@@ -56,7 +61,23 @@ std::vector<uint8_t> Tileset::getTile(const Tile& tile) const
     return ret;
 }
 
+// Unflipped pixels of one tile, one byte per pixel in row order. An
+// out-of-range index falls back to tile 0, as getTile does.
+const uint8_t* Tileset::getTilePixels(size_t index) const
+{
+    if (m_pixels.empty())
+    {
+        return nullptr;
+    }
+    if (index >= size())
+    {
+        LOG_WARNING(Log::CAT_TILESET, "Attempt to obtain out-of-range tile " << index);
+        index = 0;
+    }
+    return m_pixels.data() + index * TILE_SIZE;
+}
+
 size_t Tileset::size() const
 {
-    return m_tiles.size();
+    return m_pixels.size() / TILE_SIZE;
 }
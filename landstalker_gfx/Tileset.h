@@ -13,16 +13,26 @@ class Tileset
 public:
     Tileset();
     ~Tileset();
+    Tileset(const Tileset&) = default;
+    Tileset(Tileset&&) = default;
+    Tileset& operator=(const Tileset&) = default;
+    Tileset& operator=(Tileset&&) = default;
     
     void setBits(const uint8_t* src, size_t numTiles);
+    std::vector<uint8_t> getBits() const;
     std::vector<uint8_t> getTile(const Tile& tile) const;
+    const uint8_t* getTilePixels(size_t index) const;
     size_t size() const;
 private:
     
     static const size_t WIDTH = 8;
     static const size_t HEIGHT = 8;
     
-    std::vector<std::vector<uint8_t>> m_tiles;
+    static const size_t TILE_SIZE = WIDTH * HEIGHT;
+
+    // All tiles live in one contiguous buffer, one byte per pixel, TILE_SIZE
+    // bytes per tile. Reloading reuses the existing allocation.
+    std::vector<uint8_t> m_pixels;
 };
 
 #endif // TILESET_H
@@ -0,0 +1,43 @@
+#include "WxAdapter.h"
+
+#include <wx/image.h>
+
+wxPoint ToWx(const Point& point)
+{
+	return wxPoint(point.x, point.y);
+}
+
+wxRect ToWx(const Rect& rect)
+{
+	return wxRect(rect.x, rect.y, rect.width, rect.height);
+}
+
+Point FromWx(const wxPoint& point)
+{
+	return Point(point.x, point.y);
+}
+
+Rect FromWx(const wxRect& rect)
+{
+	return Rect(rect.x, rect.y, rect.width, rect.height);
+}
+
+// The buffer's pixels are converted to RGB (and alpha) in its own scratch
+// space; the bitmap takes a copy, so the buffer can be reused straight away.
+std::shared_ptr<wxBitmap> MakeBitmap(const ImageBuffer& buffer, const std::vector<Palette>& pals, bool use_alpha, uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity)
+{
+	const std::vector<uint8_t>& rgb = buffer.GetRGB(pals);
+	wxImage img(buffer.GetWidth(), buffer.GetHeight(), const_cast<uint8_t*>(rgb.data()), true);
+	if (use_alpha)
+	{
+		const std::vector<uint8_t>& alpha = buffer.GetAlpha(pals, low_pri_max_opacity, high_pri_max_opacity);
+		img.SetAlpha(const_cast<uint8_t*>(alpha.data()), true);
+	}
+	return std::make_shared<wxBitmap>(img);
+}
+
+std::shared_ptr<wxBitmap> MakeBitmap(const std::vector<uint8_t>& rgb, size_t width, size_t height)
+{
+	const wxImage img(width, height, const_cast<uint8_t*>(rgb.data()), true);
+	return std::make_shared<wxBitmap>(img);
+}
@@ -0,0 +1,24 @@
+#ifndef WX_ADAPTER_H
+#define WX_ADAPTER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <wx/gdicmn.h>
+#include <wx/bitmap.h>
+#include "Geometry.h"
+#include "ImageBuffer.h"
+#include "Palette.h"
+
+// The only place the core library's types meet wxWidgets. Everything here is
+// a conversion; the core itself never includes a wx header.
+
+wxPoint ToWx(const Point& point);
+wxRect ToWx(const Rect& rect);
+Point FromWx(const wxPoint& point);
+Rect FromWx(const wxRect& rect);
+
+std::shared_ptr<wxBitmap> MakeBitmap(const ImageBuffer& buffer, const std::vector<Palette>& pals, bool use_alpha = false, uint8_t low_pri_max_opacity = 0xFF, uint8_t high_pri_max_opacity = 0xFF);
+std::shared_ptr<wxBitmap> MakeBitmap(const std::vector<uint8_t>& rgb, size_t width, size_t height);
+
+#endif // WX_ADAPTER_H
@@ -0,0 +1,157 @@
+#ifndef BENCHMARK_RUNNER_H
+#define BENCHMARK_RUNNER_H
+
+// Shared timing harness for the benchmark tools. Each benchmark is a function
+// performing a fixed number of operations, e.g. decoding every tileset in a
+// ROM. It is called in batches long enough to time reliably, and the median
+// batch is reported so a stray context switch doesn't skew the result.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+class BenchmarkRunner
+{
+public:
+	// The work done by one call. Bytes and pixels are zero where they
+	// aren't meaningful.
+	struct Work
+	{
+		size_t ops;
+		size_t bytes;
+		size_t pixels;
+	};
+
+	struct Result
+	{
+		std::string name;
+		std::string input;
+		Work work;
+		size_t calls_per_batch;
+		double ns_per_op;
+		double min_ns_per_op;
+		double max_ns_per_op;
+
+		double GetMBPerSecond() const
+		{
+			return PerSecond(work.bytes);
+		}
+
+		double GetMegapixelsPerSecond() const
+		{
+			return PerSecond(work.pixels);
+		}
+
+		// Millions of units per second
+		double PerSecond(size_t units_per_call) const
+		{
+			return (ns_per_op > 0.0) ? units_per_call * 1.0e3 / (ns_per_op * work.ops) : 0.0;
+		}
+	};
+
+	BenchmarkRunner(double min_batch_seconds, size_t batches)
+		: m_min_batch_seconds(min_batch_seconds), m_batches(std::max<size_t>(batches, 1)), m_sink(0)
+	{
+	}
+
+	// The function returns a value derived from its output, which is kept
+	// so the compiler can't discard the work
+	template <class Op>
+	Result Run(const std::string& name, const std::string& input, Work work, Op op)
+	{
+		work.ops = std::max<size_t>(work.ops, 1);
+		// One untimed call warms the caches and faults in any buffers, then the
+		// batch size doubles until a batch takes long enough to time
+		m_sink += op();
+		size_t calls = 1;
+		for (;;)
+		{
+			const double seconds = TimeBatch(op, calls);
+			if ((seconds >= m_min_batch_seconds) || (calls >= (size_t(1) << 30)))
+			{
+				break;
+			}
+			calls *= 2;
+		}
+		std::vector<double> ns_per_op;
+		for (size_t i = 0; i < m_batches; ++i)
+		{
+			ns_per_op.push_back(TimeBatch(op, calls) * 1.0e9 / (calls * work.ops));
+		}
+		std::sort(ns_per_op.begin(), ns_per_op.end());
+		Result result;
+		result.name = name;
+		result.input = input;
+		result.work = work;
+		result.calls_per_batch = calls;
+		result.ns_per_op = Percentile(ns_per_op, 50.0);
+		result.min_ns_per_op = ns_per_op.front();
+		result.max_ns_per_op = ns_per_op.back();
+		m_results.push_back(result);
+		return result;
+	}
+
+	const std::vector<Result>& GetResults() const
+	{
+		return m_results;
+	}
+
+	nlohmann::json ToJson() const
+	{
+		nlohmann::json results = nlohmann::json::array();
+		for (const auto& result : m_results)
+		{
+			results.push_back({ { "name", result.name },
+			                    { "input", result.input },
+			                    { "ops_per_call", result.work.ops },
+			                    { "bytes_per_call", result.work.bytes },
+			                    { "pixels_per_call", result.work.pixels },
+			                    { "calls_per_batch", result.calls_per_batch },
+			                    { "ns_per_op", result.ns_per_op },
+			                    { "min_ns_per_op", result.min_ns_per_op },
+			                    { "max_ns_per_op", result.max_ns_per_op },
+			                    { "mb_per_s", result.GetMBPerSecond() },
+			                    { "mpixels_per_s", result.GetMegapixelsPerSecond() } });
+		}
+		return { { "min_batch_seconds", m_min_batch_seconds }, { "batches", m_batches }, { "results", results } };
+	}
+
+	// Linear interpolation between the closest ranks; values must be sorted
+	static double Percentile(const std::vector<double>& sorted, double percent)
+	{
+		if (sorted.empty())
+		{
+			return 0.0;
+		}
+		const double rank = (sorted.size() - 1) * percent / 100.0;
+		const size_t lower = static_cast<size_t>(rank);
+		const size_t upper = std::min(lower + 1, sorted.size() - 1);
+		return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - lower);
+	}
+private:
+	template <class Op>
+	double TimeBatch(Op& op, size_t calls)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		uint64_t sink = 0;
+		for (size_t i = 0; i < calls; ++i)
+		{
+			sink += op();
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		m_sink += sink;
+		return elapsed.count();
+	}
+
+	double m_min_batch_seconds;
+	size_t m_batches;
+	// Volatile, so the results of the operations are really stored
+	volatile uint64_t m_sink;
+	std::vector<Result> m_results;
+};
+
+#endif // BENCHMARK_RUNNER_H
@@ -0,0 +1,866 @@
+// Micro-benchmarks for the decoders run in bulk when loading and exporting a
+// ROM: LZ77, BitBarrel, BigTilesCmp, LSTilemapCmp and sprite frames.
+// Each is timed on synthetic inputs built from a fixed seed, so results are
+// comparable between releases, and on the inputs in a ROM when one is given.
+// With a ROM, sprite atlas packing is timed too, both from decoded frames and
+// from the shared sprite tile store, and the store's savings are reported.
+// --verify-encoder instead re-encodes every sprite frame in the ROM and
+// checks that it decodes back unchanged.
+// Links against the core library only; no wxWidgets needed.
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "BenchmarkRunner.h"
+#include "BigTilesCmp.h"
+#include "BitBarrel.h"
+#include "LSTilemapCmp.h"
+#include "LZ77.h"
+#include "Rom.h"
+#include "RomTables.h"
+#include "SpriteAtlas.h"
+#include "SpriteFrame.h"
+#include "SpriteFrameStore.h"
+#include "SpriteTileStore.h"
+#include "ThreadPool.h"
+
+namespace
+{
+const unsigned DEFAULT_SEED = 1;
+// The decoders may read a little past the end of a stream before stopping
+const size_t STREAM_PADDING = 16;
+const size_t TILE_BYTES = 32;
+
+struct Settings
+{
+	std::string rom_path;
+	std::string json_path;
+	std::string filter;
+	double min_batch_seconds = 0.05;
+	size_t batches = 5;
+	unsigned seed = DEFAULT_SEED;
+	bool verify_encoder = false;
+};
+
+void PrintUsage(const char* name)
+{
+	std::cerr << "Usage: " << name << " [options]\n"
+	          << "Options:\n"
+	          << "  --rom FILE          Also benchmark the compressed data in this ROM\n"
+	          << "  --json FILE         Write the results to FILE as JSON\n"
+	          << "  --filter TEXT       Only run benchmarks whose name contains TEXT\n"
+	          << "  --min-time SECONDS  Minimum length of each timed batch (default: 0.05)\n"
+	          << "  --batches N         Number of timed batches; the median is reported (default: 5)\n"
+	          << "  --seed N            Seed for the synthetic inputs (default: " << DEFAULT_SEED << ")\n"
+	          << "  --verify-encoder    Instead of benchmarking, check that every sprite frame in\n"
+	          << "                      the ROM given by --rom survives re-encoding unchanged\n"
+	          << "  -h, --help          Show this message\n";
+}
+
+bool ParseNumber(const std::string& text, unsigned long max, unsigned long& value)
+{
+	char* end = nullptr;
+	value = std::strtoul(text.c_str(), &end, 10);
+	return !text.empty() && (*end == '\0') && (value <= max);
+}
+
+// Writes bits most significant first, the order BitBarrel reads them in
+class BitWriter
+{
+public:
+	BitWriter() : m_pos(0) {}
+
+	void WriteBit(bool bit)
+	{
+		if (m_pos == 0)
+		{
+			m_bytes.push_back(0);
+			m_pos = 8;
+		}
+		--m_pos;
+		if (bit)
+		{
+			m_bytes.back() |= static_cast<uint8_t>(1 << m_pos);
+		}
+	}
+
+	void Write(uint32_t value, size_t bits)
+	{
+		while (bits > 0)
+		{
+			WriteBit(((value >> --bits) & 1) != 0);
+		}
+	}
+
+	void AlignToByte()
+	{
+		m_pos = 0;
+	}
+
+	const std::vector<uint8_t>& GetBytes() const
+	{
+		return m_bytes;
+	}
+private:
+	std::vector<uint8_t> m_bytes;
+	uint8_t m_pos;
+};
+
+size_t BitLength(uint32_t value)
+{
+	size_t bits = 0;
+	while (value != 0)
+	{
+		value >>= 1;
+		bits++;
+	}
+	return bits;
+}
+
+uint32_t Random(std::mt19937& rng, uint32_t max)
+{
+	return std::uniform_int_distribution<uint32_t>(0, max)(rng);
+}
+
+std::vector<uint8_t> MakeRandomBytes(std::mt19937& rng, size_t size)
+{
+	std::vector<uint8_t> bytes(size);
+	for (auto& byte : bytes)
+	{
+		byte = static_cast<uint8_t>(Random(rng, 0xFF));
+	}
+	return bytes;
+}
+
+// 4bpp tile graphics built from a small set of rows, with some blank rows
+// and tiles, so they compress about as well as the graphics in the game
+std::vector<uint8_t> MakeTileGraphics(std::mt19937& rng, size_t tiles, uint32_t blank_percent)
+{
+	std::vector<std::vector<uint8_t>> rows(64);
+	for (auto& row : rows)
+	{
+		row = MakeRandomBytes(rng, 4);
+	}
+	std::vector<uint8_t> graphics;
+	graphics.reserve(tiles * TILE_BYTES);
+	for (size_t tile = 0; tile < tiles; ++tile)
+	{
+		const bool blank_tile = Random(rng, 99) < blank_percent;
+		for (size_t y = 0; y < 8; ++y)
+		{
+			const bool blank_row = blank_tile || (Random(rng, 99) < blank_percent);
+			const std::vector<uint8_t>& row = rows[Random(rng, rows.size() - 1)];
+			for (uint8_t byte : row)
+			{
+				graphics.push_back(blank_row ? 0 : byte);
+			}
+		}
+	}
+	return graphics;
+}
+
+std::vector<uint8_t> EncodeLZ77(const std::vector<uint8_t>& data)
+{
+	std::vector<uint8_t> encoded(data.size() * 9 / 8 + STREAM_PADDING);
+	encoded.resize(LZ77::Encode(data.data(), data.size(), encoded.data()));
+	return encoded;
+}
+
+// The inverse of getCompNumber() in BigTilesCmp.cpp: zero is a single set
+// bit, anything else is stored as value + 1 = 2^exponent + mantissa
+void WriteBigTileNumber(BitWriter& bw, uint32_t value)
+{
+	const uint32_t stored = value + 1;
+	const size_t exponent = BitLength(stored) - 1;
+	bw.Write(0, exponent);
+	bw.WriteBit(true);
+	bw.Write(stored - (1 << exponent), exponent);
+}
+
+// The inverse of getCodedNumber() in LSTilemapCmp.cpp: a single set bit is
+// read as zero, anything else must be at least 2 and is stored as
+// 2^exponent + mantissa
+void WriteTilemapNumber(BitWriter& bw, uint32_t value)
+{
+	if (value < 2)
+	{
+		bw.WriteBit(true);
+		return;
+	}
+	const size_t exponent = BitLength(value) - 1;
+	bw.Write(0, exponent);
+	bw.WriteBit(true);
+	bw.Write(value - (1 << exponent), exponent);
+}
+
+// A blockset stream: the block count, three attribute masks stored as runs,
+// then the tile indices, each either new or taken from the recently used
+// queue, and the second of each pair often derived from the first
+std::vector<uint8_t> MakeBigTiles(std::mt19937& rng, size_t blocks)
+{
+	BitWriter bw;
+	bw.Write(static_cast<uint32_t>(blocks), 16);
+	const size_t tiles = blocks * 4;
+	for (int mask = 0; mask < 3; ++mask)
+	{
+		size_t pos = std::min<size_t>(Random(rng, 16), tiles);
+		WriteBigTileNumber(bw, static_cast<uint32_t>(pos));
+		while (pos < tiles)
+		{
+			const size_t run = std::min<size_t>(Random(rng, 15) + 1, tiles - pos);
+			WriteBigTileNumber(bw, static_cast<uint32_t>(run - 1));
+			pos += run;
+		}
+	}
+	auto write_tile = [&]()
+	{
+		if (Random(rng, 1) != 0)
+		{
+			bw.WriteBit(true);
+			bw.Write(Random(rng, 15), 4);
+		}
+		else
+		{
+			bw.WriteBit(false);
+			bw.Write(Random(rng, 0x7FF), 11);
+		}
+	};
+	for (size_t pair = 0; pair < tiles / 2; ++pair)
+	{
+		write_tile();
+		const bool derived = Random(rng, 1) != 0;
+		bw.WriteBit(derived);
+		if (!derived)
+		{
+			write_tile();
+		}
+	}
+	return bw.GetBytes();
+}
+
+// A room map stream: the dimensions and dictionaries, then the positions of
+// the copy and literal commands, then the literal tiles themselves, then a
+// run-length coded heightmap. Vertical command repeats are not generated.
+// The heightmap has a cell for every 2x2 tiles.
+std::vector<uint8_t> MakeRoomMap(std::mt19937& rng, size_t width, size_t height)
+{
+	BitWriter bw;
+	bw.Write(Random(rng, 0xFF), 8);
+	bw.Write(Random(rng, 0xFF), 8);
+	bw.Write(static_cast<uint32_t>(width - 1), 8);
+	bw.Write(static_cast<uint32_t>(height * 2 - 1), 8);
+	const uint32_t dictionary[2] = { Random(rng, 0x3FF), Random(rng, 0x3FF) };
+	bw.Write(dictionary[1], 10);
+	bw.Write(dictionary[0], 10);
+	std::vector<uint32_t> offsets = { 0, 1, 2, static_cast<uint32_t>(width), static_cast<uint32_t>(width * 2),
+	                                  static_cast<uint32_t>(width + 1) };
+	for (size_t i = 6; i < 14; ++i)
+	{
+		offsets.push_back(Random(rng, static_cast<uint32_t>(width * 4 - 1)) + 1);
+		bw.Write(offsets.back(), 12);
+	}
+
+	const size_t cells = width * height * 2;
+	std::vector<size_t> positions;
+	std::vector<size_t> commands;
+	for (size_t pos = 0; pos < cells; pos += Random(rng, 11) + 1)
+	{
+		// Command 0 is a run of literals; the rest copy from a fixed offset
+		// back, which must land inside the map
+		size_t command = Random(rng, 13);
+		if ((pos == 0) || (Random(rng, 1) != 0) || (offsets[command] > pos))
+		{
+			command = 0;
+		}
+		WriteTilemapNumber(bw, static_cast<uint32_t>(positions.empty() ? 1 : pos - positions.back()));
+		if (command < 6)
+		{
+			bw.Write(static_cast<uint32_t>(command), 3);
+		}
+		else
+		{
+			bw.Write(static_cast<uint32_t>(6 + ((command - 6) >> 2)), 3);
+			bw.Write(static_cast<uint32_t>((command - 6) & 3), 2);
+		}
+		bw.WriteBit(false);
+		positions.push_back(pos);
+		commands.push_back(command);
+	}
+	WriteTilemapNumber(bw, static_cast<uint32_t>(cells - positions.back()));
+
+	uint32_t next[2] = { dictionary[0], dictionary[1] };
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		if (commands[i] != 0)
+		{
+			continue;
+		}
+		const size_t end = (i + 1 < positions.size()) ? positions[i + 1] : cells;
+		for (size_t pos = positions[i]; pos < end; ++pos)
+		{
+			const uint32_t source = Random(rng, 3);
+			bw.Write(source, 2);
+			if (source == 0)
+			{
+				const size_t bits = BitLength(next[0] & 0xFFFF);
+				bw.Write(Random(rng, (1 << bits) - 1), bits);
+			}
+			else if (source == 1)
+			{
+				const size_t bits = BitLength((next[1] - dictionary[1]) & 0xFFFF);
+				bw.Write(Random(rng, (1 << bits) - 1), bits);
+			}
+			else
+			{
+				next[source - 2]++;
+			}
+		}
+	}
+
+	bw.AlignToByte();
+	bw.Write(static_cast<uint32_t>(width / 2), 8);
+	bw.Write(static_cast<uint32_t>(height / 2), 8);
+	const size_t heightmap_cells = (width / 2) * (height / 2);
+	for (size_t pos = 0; pos < heightmap_cells;)
+	{
+		const size_t run = std::min<size_t>(Random(rng, 7) + 1, heightmap_cells - pos);
+		bw.Write(Random(rng, 0xFFFF), 16);
+		bw.Write(static_cast<uint32_t>(run - 1), 8);
+		pos += run;
+	}
+	return bw.GetBytes();
+}
+
+// A sprite frame made of the given number of 4x4 tile subsprites. The
+// graphics are encoded by SpriteFrame::Encode(), starting from a frame whose
+// graphics are one run of zeroes.
+std::vector<uint8_t> MakeSpriteFrame(std::mt19937& rng, size_t subsprites)
+{
+	std::vector<uint8_t> blank;
+	for (size_t i = 0; i < subsprites; ++i)
+	{
+		const bool last = (i + 1 == subsprites);
+		blank.push_back(static_cast<uint8_t>(((i * 16) & 0x7C) | 0x03));
+		blank.push_back(static_cast<uint8_t>(((i * 8) & 0x7C) | 0x03 | (last ? 0x80 : 0x00)));
+	}
+	const size_t tiles = subsprites * 16;
+	const uint16_t zero_run = static_cast<uint16_t>(0xC000 | (tiles * TILE_BYTES / 2));
+	blank.push_back(zero_run >> 8);
+	blank.push_back(zero_run & 0xFF);
+	SpriteFrame frame(blank.data());
+	frame.m_sprite_gfx.setBits(MakeTileGraphics(rng, tiles, 30).data(), tiles);
+	return frame.Encode();
+}
+
+std::vector<uint8_t> Pad(std::vector<uint8_t> stream)
+{
+	stream.resize(stream.size() + STREAM_PADDING, 0);
+	return stream;
+}
+
+// A set of compressed inputs, decoded one after another by each call
+struct Inputs
+{
+	std::string label;
+	std::vector<const uint8_t*> streams;
+	size_t compressed_bytes = 0;
+	size_t decoded_bytes = 0;
+};
+
+// Prints the outcome of re-encoding every sprite frame in a ROM, returning
+// whether every frame decoded back unchanged
+bool PrintEncoderReport(const SpriteFrameStore::EncoderReport& report)
+{
+	const double ratio = (report.original_bytes > 0) ? 100.0 * report.encoded_bytes / report.original_bytes : 0.0;
+	std::cout << "SpriteFrame::Encode: " << report.frames << " frames, "
+	          << report.frames - report.mismatched_frames.size() << " round-trip, "
+	          << report.mismatched_frames.size() << " mismatched\n"
+	          << "  " << report.original_bytes << " -> " << report.encoded_bytes << " bytes ("
+	          << std::fixed << std::setprecision(1) << ratio << "% of the original), "
+	          << report.smaller << " frames smaller, " << report.larger << " larger\n";
+	for (size_t frame : report.mismatched_frames)
+	{
+		std::cerr << "Mismatch: sprite frame " << frame << "\n";
+	}
+	return report.mismatched_frames.empty();
+}
+
+std::string Describe(const std::string& source, size_t count, size_t compressed_bytes)
+{
+	std::ostringstream ss;
+	ss << source << " x" << count << " (" << compressed_bytes << " bytes)";
+	return ss.str();
+}
+
+class CodecBenchmarks
+{
+public:
+	CodecBenchmarks(const Settings& settings)
+		: m_settings(settings), m_runner(settings.min_batch_seconds, settings.batches)
+	{
+	}
+
+	void RunSynthetic()
+	{
+		std::mt19937 rng(m_settings.seed);
+
+		const std::vector<uint8_t> tiles = MakeTileGraphics(rng, 0x400, 15);
+		const std::vector<uint8_t> noise = MakeRandomBytes(rng, tiles.size());
+		RunLZ77("synthetic tiles", { tiles });
+		RunLZ77("synthetic noise", { noise });
+
+		const std::vector<uint8_t> bits = MakeRandomBytes(rng, 0x10000);
+		std::vector<uint8_t> mixed_widths(0x1000);
+		for (auto& width : mixed_widths)
+		{
+			width = static_cast<uint8_t>(Random(rng, 15) + 1);
+		}
+		RunBitBarrel("synthetic 1 bit", bits, { 1 });
+		RunBitBarrel("synthetic 4 bits", bits, { 4 });
+		RunBitBarrel("synthetic 11 bits", bits, { 11 });
+		RunBitBarrel("synthetic 1-16 bits", bits, mixed_widths);
+
+		std::vector<std::vector<uint8_t>> blocksets;
+		std::vector<std::vector<uint8_t>> maps;
+		std::vector<std::vector<uint8_t>> frames;
+		for (int i = 0; i < 8; ++i)
+		{
+			blocksets.push_back(Pad(MakeBigTiles(rng, 0x100)));
+			maps.push_back(Pad(MakeRoomMap(rng, 48, 48)));
+			frames.push_back(Pad(MakeSpriteFrame(rng, 2)));
+		}
+		RunBigTiles(MakeInputs(FORMAT_BIG_TILES, "synthetic blocksets", blocksets));
+		RunRoomMaps(MakeInputs(FORMAT_ROOM_MAP, "synthetic room maps", maps));
+		RunSpriteFrames(MakeInputs(FORMAT_SPRITE_FRAME, "synthetic sprite frames", frames));
+	}
+
+	void RunRom(const Rom& rom, const RomTables& tables)
+	{
+		std::vector<std::vector<uint8_t>> tilesets;
+		for (uint32_t offset : Unique(tables.tilesetOffsets))
+		{
+			std::vector<uint8_t> buffer(65536);
+			size_t length = 0;
+			buffer.resize(LZ77::Decode(rom.data(offset), buffer.size(), buffer.data(), length));
+			tilesets.push_back(buffer);
+		}
+		RunLZ77("rom tilesets", tilesets);
+
+		std::vector<uint32_t> blocksets;
+		for (const auto& table : tables.bigTileOffsets)
+		{
+			blocksets.insert(blocksets.end(), table.begin(), table.end());
+		}
+		std::vector<uint32_t> maps;
+		for (const auto& room : tables.rooms)
+		{
+			maps.push_back(room.offset);
+		}
+		RunBigTiles(MakeInputs(FORMAT_BIG_TILES, "rom blocksets", rom, Unique(blocksets)));
+		RunRoomMaps(MakeInputs(FORMAT_ROOM_MAP, "rom room maps", rom, Unique(maps)));
+		RunSpriteFrames(MakeInputs(FORMAT_SPRITE_FRAME, "rom sprite frames", rom, Unique(tables.spriteFrameOffsets)));
+		RunSpriteAtlases(rom, tables);
+	}
+
+	const BenchmarkRunner& GetRunner() const
+	{
+		return m_runner;
+	}
+private:
+	template <class Op>
+	void Run(const std::string& name, const std::string& input, size_t ops, size_t bytes, Op op)
+	{
+		if (name.find(m_settings.filter) == std::string::npos)
+		{
+			return;
+		}
+		const BenchmarkRunner::Result result = m_runner.Run(name, input, BenchmarkRunner::Work{ ops, bytes, 0 }, op);
+		std::cout << std::left << std::setw(24) << result.name << std::setw(40) << result.input << std::right
+		          << std::fixed << std::setprecision(1) << std::setw(14) << result.ns_per_op << " ns/op"
+		          << std::setw(10) << result.GetMBPerSecond() << " MB/s" << std::endl;
+	}
+
+	// Decoding measures throughput in decoded bytes and encoding in input
+	// bytes, so both are in terms of the uncompressed data
+	void RunLZ77(const std::string& label, const std::vector<std::vector<uint8_t>>& data)
+	{
+		std::vector<std::vector<uint8_t>> encoded;
+		size_t decoded_bytes = 0;
+		size_t encoded_bytes = 0;
+		for (const auto& item : data)
+		{
+			encoded.push_back(Pad(EncodeLZ77(item)));
+			decoded_bytes += item.size();
+			encoded_bytes += encoded.back().size() - STREAM_PADDING;
+		}
+		std::vector<uint8_t> output(65536 + 0x100);
+		const std::string input = Describe(label, data.size(), encoded_bytes);
+		Run("LZ77::Decode", input, encoded.size(), decoded_bytes, [&]()
+		{
+			size_t total = 0;
+			for (const auto& stream : encoded)
+			{
+				size_t length = 0;
+				total += LZ77::Decode(stream.data(), stream.size(), output.data(), length);
+			}
+			return total;
+		});
+		std::vector<uint8_t> scratch(65536 * 9 / 8 + STREAM_PADDING);
+		Run("LZ77::Encode", input, data.size(), decoded_bytes, [&]()
+		{
+			size_t total = 0;
+			for (const auto& item : data)
+			{
+				total += LZ77::Encode(item.data(), item.size(), scratch.data());
+			}
+			return total;
+		});
+	}
+
+	// Each call reads the widths in turn until the buffer runs out; one
+	// operation is one readBits() call
+	void RunBitBarrel(const std::string& label, const std::vector<uint8_t>& bits, const std::vector<uint8_t>& widths)
+	{
+		std::vector<uint8_t> reads;
+		size_t remaining = bits.size() * 8;
+		for (size_t i = 0; widths[i % widths.size()] <= remaining; ++i)
+		{
+			reads.push_back(widths[i % widths.size()]);
+			remaining -= reads.back();
+		}
+		std::ostringstream input;
+		input << label << " x" << reads.size();
+		Run("BitBarrel::readBits", input.str(), reads.size(), bits.size() - remaining / 8, [&]()
+		{
+			BitBarrel bb(bits.data());
+			uint32_t total = 0;
+			for (uint8_t width : reads)
+			{
+				total += bb.readBits(width);
+			}
+			return total;
+		});
+	}
+
+	void RunBigTiles(const Inputs& inputs)
+	{
+		std::vector<BigTile> blockset;
+		Run("BigTilesCmp::Decode", inputs.label, inputs.streams.size(), inputs.decoded_bytes, [&]()
+		{
+			size_t total = 0;
+			for (const uint8_t* stream : inputs.streams)
+			{
+				blockset.clear();
+				total += BigTilesCmp::Decode(stream, blockset);
+			}
+			return total;
+		});
+	}
+
+	void RunRoomMaps(const Inputs& inputs)
+	{
+		RoomTilemap map;
+		Run("LSTilemapCmp::Decode", inputs.label, inputs.streams.size(), inputs.decoded_bytes, [&]()
+		{
+			size_t total = 0;
+			for (const uint8_t* stream : inputs.streams)
+			{
+				total += LSTilemapCmp::Decode(stream, map);
+			}
+			return total;
+		});
+	}
+
+	void RunSpriteFrames(const Inputs& inputs)
+	{
+		Run("SpriteFrame", inputs.label, inputs.streams.size(), inputs.decoded_bytes, [&]()
+		{
+			size_t total = 0;
+			for (const uint8_t* stream : inputs.streams)
+			{
+				total += SpriteFrame(stream).GetUncompressedSize();
+			}
+			return total;
+		});
+	}
+
+	enum Format
+	{
+		FORMAT_BIG_TILES,
+		FORMAT_ROOM_MAP,
+		FORMAT_SPRITE_FRAME
+	};
+
+	// Returns the number of bytes the stream decodes to, with the 16-bit
+	// words of blocksets, maps and heightmaps counted as two bytes each
+	static size_t Decode(Format format, const uint8_t* stream, size_t& length)
+	{
+		switch (format)
+		{
+		case FORMAT_BIG_TILES:
+		{
+			std::vector<BigTile> blockset;
+			return BigTilesCmp::Decode(stream, blockset, length) * 4 * 2;
+		}
+		case FORMAT_ROOM_MAP:
+		{
+			RoomTilemap map;
+			LSTilemapCmp::Decode(stream, map, length);
+			return (map.GetWidth() * map.GetHeight() * 2 + map.heightmap.size()) * 2;
+		}
+		case FORMAT_SPRITE_FRAME:
+		{
+			SpriteFrame frame(stream);
+			length = frame.GetCompressedSize();
+			return frame.GetUncompressedSize();
+		}
+		}
+		return 0;
+	}
+
+	// Packs the frames of each sprite graphic into an atlas, as the browser
+	// does when a sprite is selected
+	void RunSpriteAtlases(const Rom& rom, const RomTables& tables)
+	{
+		ThreadPool pool;
+		SpriteFrameStore store;
+		store.Init(rom, tables.spriteFrameOffsets);
+		const std::vector<std::shared_ptr<const SpriteFrame>> frames = store.DecodeAll(pool);
+		SpriteTileStore tiles;
+		tiles.Build(frames, pool);
+		PrintTileReport(tiles.GetReport());
+
+		std::vector<std::vector<size_t>> sprites;
+		size_t frame_count = 0;
+		for (const auto& sg : tables.spriteGraphics)
+		{
+			std::vector<size_t> ids;
+			for (size_t a = 0; a < sg.GetAnimationCount(); ++a)
+			{
+				for (size_t f = 0; f < sg.GetFrameCount(a); ++f)
+				{
+					const size_t id = sg.RetrieveFrameIdx(a, f);
+					if ((id < frames.size()) && (frames[id] != nullptr))
+					{
+						ids.push_back(id);
+					}
+				}
+			}
+			frame_count += ids.size();
+			sprites.push_back(ids);
+		}
+		std::ostringstream ss;
+		ss << "rom sprites x" << sprites.size() << " (" << frame_count << " frames)";
+		const std::string input = ss.str();
+		SpriteAtlas atlas;
+		Run("SpriteAtlas frames", input, sprites.size(), 0, [&]()
+		{
+			size_t pages = 0;
+			for (const auto& ids : sprites)
+			{
+				std::map<size_t, std::shared_ptr<const SpriteFrame>> sprite_frames;
+				for (size_t id : ids)
+				{
+					sprite_frames[id] = frames[id];
+				}
+				atlas.Build(sprite_frames, 1);
+				pages += atlas.GetPageCount();
+			}
+			return pages;
+		});
+		Run("SpriteAtlas tiles", input, sprites.size(), 0, [&]()
+		{
+			size_t pages = 0;
+			for (const auto& ids : sprites)
+			{
+				atlas.Build(ids, tiles, 1);
+				pages += atlas.GetPageCount();
+			}
+			return pages;
+		});
+	}
+
+	void PrintTileReport(const SpriteTileStore::Report& report)
+	{
+		if (std::string("SpriteTileStore").find(m_settings.filter) == std::string::npos)
+		{
+			return;
+		}
+		const double saved = (report.original_bytes > 0) ? 100.0 * (report.original_bytes - report.stored_bytes) / report.original_bytes : 0.0;
+		std::cout << "SpriteTileStore: " << report.frames << " frames, " << report.tiles << " tiles ("
+		          << report.blank_tiles << " blank), " << report.unique_exact << " unique, "
+		          << report.unique_with_flips << " unique with flips; " << report.original_bytes << " -> "
+		          << report.stored_bytes << " bytes (" << std::fixed << std::setprecision(1) << saved << "% saved)" << std::endl;
+	}
+
+	// Decodes each stream once to find its sizes, and checks the generators
+	// above still agree with the decoders
+	static Inputs MakeInputs(Format format, const std::string& source, const std::vector<std::vector<uint8_t>>& streams)
+	{
+		Inputs inputs;
+		for (const auto& stream : streams)
+		{
+			size_t length = 0;
+			inputs.decoded_bytes += Decode(format, stream.data(), length);
+			inputs.compressed_bytes += length;
+			inputs.streams.push_back(stream.data());
+			if (length != stream.size() - STREAM_PADDING)
+			{
+				throw std::runtime_error("The " + source + " do not match their decoder");
+			}
+		}
+		inputs.label = Describe(source, streams.size(), inputs.compressed_bytes);
+		return inputs;
+	}
+
+	static Inputs MakeInputs(Format format, const std::string& source, const Rom& rom, const std::vector<uint32_t>& offsets)
+	{
+		Inputs inputs;
+		for (uint32_t offset : offsets)
+		{
+			size_t length = 0;
+			inputs.decoded_bytes += Decode(format, rom.data(offset), length);
+			inputs.compressed_bytes += length;
+			inputs.streams.push_back(rom.data(offset));
+		}
+		inputs.label = Describe(source, offsets.size(), inputs.compressed_bytes);
+		return inputs;
+	}
+
+	static std::vector<uint32_t> Unique(std::vector<uint32_t> offsets)
+	{
+		std::sort(offsets.begin(), offsets.end());
+		offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+		offsets.erase(std::remove(offsets.begin(), offsets.end(), 0u), offsets.end());
+		return offsets;
+	}
+
+	Settings m_settings;
+	BenchmarkRunner m_runner;
+};
+}
+
+int main(int argc, char** argv)
+{
+	Settings settings;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool has_value = (i + 1 < argc);
+		unsigned long value = 0;
+		if ((arg == "-h") || (arg == "--help"))
+		{
+			PrintUsage(argv[0]);
+			return 0;
+		}
+		else if ((arg == "--rom") && has_value)
+		{
+			settings.rom_path = argv[++i];
+		}
+		else if ((arg == "--json") && has_value)
+		{
+			settings.json_path = argv[++i];
+		}
+		else if ((arg == "--filter") && has_value)
+		{
+			settings.filter = argv[++i];
+		}
+		else if ((arg == "--min-time") && has_value)
+		{
+			char* end = nullptr;
+			settings.min_batch_seconds = std::strtod(argv[++i], &end);
+			if ((*end != '\0') || !(settings.min_batch_seconds > 0.0))
+			{
+				std::cerr << "Invalid minimum time \"" << argv[i] << "\"\n";
+				return 1;
+			}
+		}
+		else if ((arg == "--batches") && has_value)
+		{
+			if (!ParseNumber(argv[++i], 1000, value) || (value == 0))
+			{
+				std::cerr << "Invalid batch count \"" << argv[i] << "\"\n";
+				return 1;
+			}
+			settings.batches = value;
+		}
+		else if (arg == "--verify-encoder")
+		{
+			settings.verify_encoder = true;
+		}
+		else if ((arg == "--seed") && has_value)
+		{
+			if (!ParseNumber(argv[++i], 0xFFFFFFFF, value))
+			{
+				std::cerr << "Invalid seed \"" << argv[i] << "\"\n";
+				return 1;
+			}
+			settings.seed = static_cast<unsigned>(value);
+		}
+		else
+		{
+			std::cerr << "Unknown option \"" << arg << "\"\n";
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (settings.verify_encoder && settings.rom_path.empty())
+	{
+		std::cerr << "--verify-encoder needs a ROM given by --rom\n";
+		return 1;
+	}
+
+	try
+	{
+		if (settings.verify_encoder)
+		{
+			const Rom rom(settings.rom_path);
+			RomTables tables;
+			tables.Load(rom, RomTables::SECTION_SPRITES);
+			ThreadPool pool;
+			SpriteFrameStore frames;
+			frames.Init(rom, tables.spriteFrameOffsets);
+			return PrintEncoderReport(frames.VerifyEncoder(pool)) ? 0 : 2;
+		}
+		CodecBenchmarks benchmarks(settings);
+		benchmarks.RunSynthetic();
+		if (!settings.rom_path.empty())
+		{
+			const Rom rom(settings.rom_path);
+			RomTables tables;
+			tables.Load(rom);
+			benchmarks.RunRom(rom, tables);
+		}
+		if (!settings.json_path.empty())
+		{
+			nlohmann::json doc = benchmarks.GetRunner().ToJson();
+			doc["benchmark"] = "codecs";
+			doc["seed"] = settings.seed;
+			doc["rom"] = settings.rom_path.empty() ? nlohmann::json() : nlohmann::json(settings.rom_path);
+			std::ofstream outfile(settings.json_path, std::ios::out | std::ios::trunc);
+			if (!outfile.is_open() || !(outfile << doc.dump(1, '\t') << std::endl))
+			{
+				std::cerr << "Unable to write \"" << settings.json_path << "\"\n";
+				return 1;
+			}
+		}
+		return 0;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << "\n";
+		return 1;
+	}
+}
@@ -0,0 +1,260 @@
+// Headless batch exporter: renders every tileset, blockset, room, heightmap
+// and sprite frame of a ROM to PNG files, spread across a pool of workers.
+// Links against the core library only; no wxWidgets needed.
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include "BatchExporter.h"
+#include "ExportManifest.h"
+#include "Rom.h"
+#include "RomTables.h"
+#include "ThreadPool.h"
+
+namespace
+{
+void PrintUsage(const char* name)
+{
+	std::cerr << "Usage: " << name << " [options] rom_file output_dir\n"
+	          << "Options:\n"
+	          << "  -j, --jobs N            Number of worker threads (default: one per core)\n"
+	          << "  --assets LIST           Comma-separated assets to export, from: tilesets,\n"
+	          << "                          blocksets, rooms, heightmaps, sprites, all (default: all)\n"
+	          << "  --layers LIST           Comma-separated room layers, from: bg, fg, heightmap\n"
+	          << "                          (default: bg,fg)\n"
+	          << "  --heightmap-opacity N   Opacity of the heightmap room layer, 0-255 (default: 128)\n"
+	          << "  -i, --incremental       Only export images whose inputs have changed since the\n"
+	          << "                          last incremental export to the same directory\n"
+	          << "  --manifest FILE         Manifest for incremental exports\n"
+	          << "                          (default: output_dir/manifest.json)\n"
+	          << "  -h, --help              Show this message\n";
+}
+
+std::vector<std::string> Split(const std::string& list)
+{
+	std::vector<std::string> items;
+	std::istringstream ss(list);
+	std::string item;
+	while (std::getline(ss, item, ','))
+	{
+		if (!item.empty())
+		{
+			items.push_back(item);
+		}
+	}
+	return items;
+}
+
+bool ParseNumber(const std::string& text, unsigned long max, unsigned long& value)
+{
+	char* end = nullptr;
+	value = std::strtoul(text.c_str(), &end, 10);
+	return !text.empty() && (*end == '\0') && (value <= max);
+}
+
+bool ParseAssets(const std::string& list, uint32_t& assets)
+{
+	assets = 0;
+	for (const auto& item : Split(list))
+	{
+		if (item == "tilesets") assets |= BatchExporter::ASSET_TILESETS;
+		else if (item == "blocksets") assets |= BatchExporter::ASSET_BLOCKSETS;
+		else if (item == "rooms") assets |= BatchExporter::ASSET_ROOMS;
+		else if (item == "heightmaps") assets |= BatchExporter::ASSET_HEIGHTMAPS;
+		else if (item == "sprites") assets |= BatchExporter::ASSET_SPRITE_FRAMES;
+		else if (item == "all") assets |= BatchExporter::ASSET_ALL;
+		else return false;
+	}
+	return assets != 0;
+}
+
+bool ParseLayers(const std::string& list, uint32_t& layers)
+{
+	layers = 0;
+	for (const auto& item : Split(list))
+	{
+		if (item == "bg") layers |= BatchExporter::ROOM_BACKGROUND;
+		else if (item == "fg") layers |= BatchExporter::ROOM_FOREGROUND;
+		else if (item == "heightmap") layers |= BatchExporter::ROOM_HEIGHTMAP;
+		else return false;
+	}
+	return layers != 0;
+}
+
+bool MakeDirectory(const std::string& path)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) == 0)
+	{
+		return (info.st_mode & S_IFDIR) != 0;
+	}
+#ifdef _WIN32
+	return _mkdir(path.c_str()) == 0;
+#else
+	return mkdir(path.c_str(), 0755) == 0;
+#endif
+}
+
+void PrintSummary(const BatchExporter::Summary& summary)
+{
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Exported " << summary.images << " of " << summary.jobs << " images in "
+	          << summary.seconds << " s using " << summary.workers << " workers ("
+	          << summary.unchanged << " unchanged, " << summary.skipped << " empty, "
+	          << summary.errors.size() << " failed)\n";
+	for (const auto& totals : summary.totals)
+	{
+		std::cout << "  " << std::left << std::setw(14) << BatchExporter::GetAssetName(totals.first) << std::right
+		          << std::setw(6) << totals.second.images << " images "
+		          << std::setw(9) << totals.second.pixels / 1.0e6 << " Mpixels "
+		          << std::setw(9) << totals.second.render_seconds << " worker s\n";
+	}
+	const BatchExporter::SpriteDecodeTotals& decode = summary.sprite_decode;
+	if (decode.frames > 0)
+	{
+		std::cout << "Sprite decode: " << decode.frames - decode.failed << " of " << decode.frames << " frames in "
+		          << decode.seconds * 1000.0 << " ms (" << decode.worker_seconds * 1000.0 << " worker ms), "
+		          << decode.compressed_bytes << " -> " << decode.uncompressed_bytes << " bytes";
+		if (decode.slowest_us > 0.0)
+		{
+			std::cout << ", slowest " << decode.slowest_us << " us at 0x" << std::hex << std::uppercase
+			          << decode.slowest_offset << std::dec << std::nouppercase;
+		}
+		std::cout << "\n";
+	}
+	if (summary.seconds > 0.0)
+	{
+		std::cout << "Throughput: " << summary.images / summary.seconds << " images/s, "
+		          << summary.pixels / 1.0e6 / summary.seconds << " Mpixels/s\n";
+	}
+	for (const auto& error : summary.errors)
+	{
+		std::cerr << "Error: " << error << "\n";
+	}
+}
+}
+
+int main(int argc, char** argv)
+{
+	BatchExporter::Options options;
+	size_t workers = 0;
+	bool incremental = false;
+	std::string manifest_path;
+	std::vector<std::string> positional;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool has_value = (i + 1 < argc);
+		unsigned long value = 0;
+		if ((arg == "-h") || (arg == "--help"))
+		{
+			PrintUsage(argv[0]);
+			return 0;
+		}
+		else if (((arg == "-j") || (arg == "--jobs")) && has_value)
+		{
+			if (!ParseNumber(argv[++i], 1024, value) || (value == 0))
+			{
+				std::cerr << "Invalid worker count \"" << argv[i] << "\"\n";
+				return 1;
+			}
+			workers = value;
+		}
+		else if ((arg == "--assets") && has_value)
+		{
+			if (!ParseAssets(argv[++i], options.assets))
+			{
+				std::cerr << "Invalid asset list \"" << argv[i] << "\"\n";
+				return 1;
+			}
+		}
+		else if ((arg == "--layers") && has_value)
+		{
+			if (!ParseLayers(argv[++i], options.room_layers))
+			{
+				std::cerr << "Invalid layer list \"" << argv[i] << "\"\n";
+				return 1;
+			}
+		}
+		else if ((arg == "--heightmap-opacity") && has_value)
+		{
+			if (!ParseNumber(argv[++i], 0xFF, value))
+			{
+				std::cerr << "Invalid opacity \"" << argv[i] << "\"\n";
+				return 1;
+			}
+			options.heightmap_opacity = static_cast<uint8_t>(value);
+		}
+		else if ((arg == "-i") || (arg == "--incremental"))
+		{
+			incremental = true;
+		}
+		else if ((arg == "--manifest") && has_value)
+		{
+			manifest_path = argv[++i];
+			incremental = true;
+		}
+		else if (!arg.empty() && (arg[0] == '-'))
+		{
+			std::cerr << "Unknown option \"" << arg << "\"\n";
+			PrintUsage(argv[0]);
+			return 1;
+		}
+		else
+		{
+			positional.push_back(arg);
+		}
+	}
+	if (positional.size() != 2)
+	{
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	options.output_dir = positional[1];
+	if (manifest_path.empty())
+	{
+		manifest_path = options.output_dir + "/manifest.json";
+	}
+
+	try
+	{
+		auto rom = std::make_shared<const Rom>(positional[0]);
+		ThreadPool pool(workers);
+		RomTables tables;
+		tables.Load(*rom);
+		if (!MakeDirectory(options.output_dir))
+		{
+			std::cerr << "Unable to create output directory \"" << options.output_dir << "\"\n";
+			return 1;
+		}
+		BatchExporter exporter(rom, tables);
+		ExportManifest manifest;
+		if (incremental)
+		{
+			manifest.Load(manifest_path);
+		}
+		const BatchExporter::Summary summary = exporter.Export(options, pool, incremental ? &manifest : nullptr);
+		if (incremental)
+		{
+			manifest.Save(manifest_path);
+		}
+		PrintSummary(summary);
+		return summary.errors.empty() ? 0 : 2;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << "\n";
+		return 1;
+	}
+}
@@ -0,0 +1,890 @@
+// Throughput benchmarks for the render side: tile lookups, drawing tiles,
+// blocks, maps and sprites into an ImageBuffer, palette conversion, room
+// compositing and PNG encoding. Before the sprite blitter is timed, it is
+// checked that flipped sprites are mirror images of unflipped ones. Full room
+// renders are also timed across a range of thread counts, with per-room
+// latency percentiles, to show how the renderer scales. Rooms are synthetic,
+// built from a fixed seed, unless a ROM is given.
+// Links against the core library only; no wxWidgets needed.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "AssetCache.h"
+#include "BenchmarkRunner.h"
+#include "BigTile.h"
+#include "Blockmap2D.h"
+#include "HeightmapOverlay.h"
+#include "ImageBuffer.h"
+#include "LSTilemapCmp.h"
+#include "Palette.h"
+#include "Rom.h"
+#include "RomTables.h"
+#include "RoomRenderCache.h"
+#include "SpriteFrame.h"
+#include "ThreadPool.h"
+#include "Tilemap2D.h"
+#include "Tileset.h"
+
+namespace
+{
+const unsigned DEFAULT_SEED = 1;
+const size_t DEFAULT_ROOMS = 16;
+const size_t DEFAULT_ROUNDS = 5;
+const size_t TILE_COUNT = 0x400;
+const size_t BLOCK_COUNT = 0x400;
+// The tile and block benchmarks draw into a buffer of this size
+const size_t BUFFER_SIZE = 512;
+const size_t SPRITE_FRAMES = 8;
+
+struct Settings
+{
+	std::string rom_path;
+	std::string json_path;
+	std::string filter;
+	std::string scratch_path = "lsrenderbench.tmp.png";
+	double min_batch_seconds = 0.05;
+	size_t batches = 5;
+	unsigned seed = DEFAULT_SEED;
+	size_t rooms = DEFAULT_ROOMS;
+	size_t rounds = DEFAULT_ROUNDS;
+	std::vector<size_t> threads;
+};
+
+void PrintUsage(const char* name)
+{
+	std::cerr << "Usage: " << name << " [options]\n"
+	          << "Options:\n"
+	          << "  --rom FILE          Render the rooms in this ROM rather than synthetic ones\n"
+	          << "  --rooms N           Number of rooms to render, spread evenly through the ROM;\n"
+	          << "                      0 for every room (default: " << DEFAULT_ROOMS << ")\n"
+	          << "  --threads LIST      Comma-separated thread counts for the scaling test\n"
+	          << "                      (default: powers of two up to one per core)\n"
+	          << "  --rounds N          Times each room is rendered per thread count (default: " << DEFAULT_ROUNDS << ")\n"
+	          << "  --json FILE         Write the results to FILE as JSON\n"
+	          << "  --filter TEXT       Only run benchmarks whose name contains TEXT\n"
+	          << "  --min-time SECONDS  Minimum length of each timed batch (default: 0.05)\n"
+	          << "  --batches N         Number of timed batches; the median is reported (default: 5)\n"
+	          << "  --seed N            Seed for the synthetic inputs (default: " << DEFAULT_SEED << ")\n"
+	          << "  --scratch FILE      File the PNG benchmarks write to, removed afterwards\n"
+	          << "                      (default: lsrenderbench.tmp.png)\n"
+	          << "  -h, --help          Show this message\n";
+}
+
+bool ParseNumber(const std::string& text, unsigned long max, unsigned long& value)
+{
+	char* end = nullptr;
+	value = std::strtoul(text.c_str(), &end, 10);
+	return !text.empty() && (*end == '\0') && (value <= max);
+}
+
+bool ParseThreads(const std::string& list, std::vector<size_t>& threads)
+{
+	threads.clear();
+	std::istringstream ss(list);
+	std::string item;
+	while (std::getline(ss, item, ','))
+	{
+		unsigned long value = 0;
+		if (!ParseNumber(item, 1024, value) || (value == 0))
+		{
+			return false;
+		}
+		threads.push_back(value);
+	}
+	return !threads.empty();
+}
+
+std::vector<size_t> GetDefaultThreads()
+{
+	std::vector<size_t> threads;
+	const size_t cores = ThreadPool::DefaultWorkerCount();
+	for (size_t count = 1; count < cores; count *= 2)
+	{
+		threads.push_back(count);
+	}
+	threads.push_back(cores);
+	return threads;
+}
+
+uint32_t Random(std::mt19937& rng, uint32_t max)
+{
+	return std::uniform_int_distribution<uint32_t>(0, max)(rng);
+}
+
+Tile RandomTile(std::mt19937& rng)
+{
+	return Tile(TileAttributes(Random(rng, 1) != 0, Random(rng, 1) != 0, Random(rng, 1) != 0),
+	            static_cast<uint16_t>(Random(rng, TILE_COUNT - 1)));
+}
+
+// A sprite frame of up to four subsprites at random offsets, some negative,
+// with random graphics. The stream only describes the subsprites and a run of
+// zeroes for the graphics, which are filled in afterwards.
+SpriteFrame MakeSpriteFrame(std::mt19937& rng)
+{
+	std::vector<uint8_t> stream;
+	const size_t subsprites = Random(rng, 3) + 1;
+	size_t tiles = 0;
+	for (size_t i = 0; i < subsprites; ++i)
+	{
+		const uint8_t y_h = static_cast<uint8_t>((Random(rng, 0xFF) & 0x7C) | Random(rng, 3));
+		const uint8_t x_w = static_cast<uint8_t>((Random(rng, 0xFF) & 0x7C) | Random(rng, 3));
+		stream.push_back(y_h);
+		stream.push_back(static_cast<uint8_t>(x_w | ((i + 1 == subsprites) ? 0x80 : 0x00)));
+		tiles += ((y_h & 0x03) + 1) * ((x_w & 0x03) + 1);
+	}
+	const uint16_t zero_run = static_cast<uint16_t>(0xC000 | (tiles * 16));
+	stream.push_back(zero_run >> 8);
+	stream.push_back(zero_run & 0xFF);
+	SpriteFrame frame(stream.data());
+	std::vector<uint8_t> gfx(tiles * 32);
+	for (auto& byte : gfx)
+	{
+		byte = static_cast<uint8_t>(Random(rng, 0xFF));
+	}
+	frame.m_sprite_gfx.setBits(gfx.data(), tiles);
+	return frame;
+}
+
+// Flipping mirrors a sprite about its origin. So a frame drawn flipped, with
+// its origin at the mirrored position, must be the mirror image of the frame
+// drawn unflipped, including where either is clipped by the buffer's edges.
+void CheckSpriteFlips(const SpriteFrame& frame, const std::vector<Palette>& pals)
+{
+	const int width = 64;
+	const int height = 48;
+	for (int y = -40; y < height + 40; y += 11)
+	{
+		for (int x = -40; x < width + 40; x += 9)
+		{
+			ImageBuffer plain(width, height);
+			plain.InsertSprite(x, y, 1, frame);
+			const std::vector<uint8_t> expected = plain.GetRGB(pals);
+			for (int flip = 1; flip < 4; ++flip)
+			{
+				const bool hflip = (flip & 1) != 0;
+				const bool vflip = (flip & 2) != 0;
+				ImageBuffer flipped(width, height);
+				flipped.InsertSprite(hflip ? width - x : x, vflip ? height - y : y, 1, frame, hflip, vflip);
+				const std::vector<uint8_t>& actual = flipped.GetRGB(pals);
+				for (int row = 0; row < height; ++row)
+				{
+					for (int col = 0; col < width; ++col)
+					{
+						const size_t mirrored = (vflip ? height - 1 - row : row) * width + (hflip ? width - 1 - col : col);
+						if (!std::equal(&expected[(row * width + col) * 3], &expected[(row * width + col) * 3] + 3, &actual[mirrored * 3]))
+						{
+							std::ostringstream ss;
+							ss << "Sprite frame drawn at (" << x << ", " << y << ") with"
+							   << (hflip ? " H" : "") << (vflip ? " V" : "")
+							   << " flip is not the mirror image of the unflipped frame";
+							throw std::runtime_error(ss.str());
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+struct Room
+{
+	size_t index;
+	std::shared_ptr<RoomTilemap> map;
+	std::vector<Palette> pals;
+	size_t width;
+	size_t height;
+};
+
+// The tileset, blockset and palettes used by the tile and block benchmarks,
+// and the rooms rendered by the rest
+struct Scene
+{
+	std::string source;
+	std::shared_ptr<const Tileset> tileset;
+	std::shared_ptr<const std::vector<BigTile>> blockset;
+	std::vector<Palette> pals;
+	std::vector<Room> rooms;
+	size_t room_pixels = 0;
+};
+
+// 4bpp tiles with roughly a fifth of their rows blank, as in the game's
+// graphics, so the transparency checks in the draw loops are exercised
+std::shared_ptr<const Tileset> MakeTileset(std::mt19937& rng)
+{
+	std::vector<uint8_t> bits;
+	for (size_t row = 0; row < TILE_COUNT * 8; ++row)
+	{
+		const bool blank = Random(rng, 4) == 0;
+		for (size_t i = 0; i < 4; ++i)
+		{
+			bits.push_back(blank ? 0 : static_cast<uint8_t>(Random(rng, 0xFF)));
+		}
+	}
+	auto tileset = std::make_shared<Tileset>();
+	tileset->setBits(bits.data(), TILE_COUNT);
+	return tileset;
+}
+
+std::shared_ptr<const std::vector<BigTile>> MakeBlockset(std::mt19937& rng)
+{
+	auto blockset = std::make_shared<std::vector<BigTile>>();
+	for (size_t i = 0; i < BLOCK_COUNT; ++i)
+	{
+		std::vector<Tile> tiles;
+		for (size_t j = 0; j < 4; ++j)
+		{
+			tiles.push_back(RandomTile(rng));
+		}
+		blockset->push_back(BigTile(tiles.begin(), tiles.end()));
+	}
+	return blockset;
+}
+
+// Colour 0 of each palette is transparent, as on the hardware
+std::vector<Palette> MakePalettes(std::mt19937& rng)
+{
+	std::vector<Palette> pals(4);
+	for (auto& pal : pals)
+	{
+		pal.set(0, 0, 0, 0, 0);
+		for (uint8_t i = 1; i < 16; ++i)
+		{
+			pal.set(i, static_cast<uint8_t>(Random(rng, 0xFF)), static_cast<uint8_t>(Random(rng, 0xFF)),
+			        static_cast<uint8_t>(Random(rng, 0xFF)));
+		}
+	}
+	return pals;
+}
+
+void AddRoom(Scene& scene, size_t index, std::shared_ptr<RoomTilemap> map, std::vector<Palette> pals)
+{
+	Room room{ index, map, pals, map->background.GetBitmapWidth(), map->background.GetBitmapHeight() };
+	if ((room.width != 0) && (room.height != 0))
+	{
+		scene.rooms.push_back(room);
+		scene.room_pixels += room.width * room.height;
+	}
+}
+
+// Rooms of random sizes, with about a third of the foreground blocks empty
+Scene MakeSyntheticScene(const Settings& settings)
+{
+	std::mt19937 rng(settings.seed);
+	Scene scene;
+	scene.source = "synthetic";
+	scene.tileset = MakeTileset(rng);
+	scene.blockset = MakeBlockset(rng);
+	scene.pals = MakePalettes(rng);
+	const size_t rooms = (settings.rooms != 0) ? settings.rooms : DEFAULT_ROOMS;
+	for (size_t i = 0; i < rooms; ++i)
+	{
+		const uint8_t width = static_cast<uint8_t>(Random(rng, 48) + 16);
+		const uint8_t height = static_cast<uint8_t>(Random(rng, 48) + 16);
+		auto map = std::make_shared<RoomTilemap>();
+		map->set(0, 0, width, height);
+		for (size_t y = 0; y < height; ++y)
+		{
+			for (size_t x = 0; x < width; ++x)
+			{
+				map->background.SetTileValue({ x, y }, static_cast<uint16_t>(Random(rng, BLOCK_COUNT - 1)));
+				const bool empty = Random(rng, 2) == 0;
+				map->foreground.SetTileValue({ x, y }, empty ? 0 : static_cast<uint16_t>(Random(rng, BLOCK_COUNT - 1)));
+			}
+		}
+		map->hmwidth = width;
+		map->hmheight = height;
+		for (size_t cell = 0; cell < size_t(width) * height; ++cell)
+		{
+			map->heightmap.push_back(HeightMapCell(static_cast<uint16_t>(Random(rng, 0xFFFF))));
+		}
+		for (auto* layer : { &map->background, &map->foreground })
+		{
+			layer->SetTileset(scene.tileset);
+			layer->SetBlockset(scene.blockset);
+		}
+		AddRoom(scene, i, map, scene.pals);
+	}
+	return scene;
+}
+
+// Rooms spread evenly through the ROM's room table, drawn with their own
+// tilesets, blocksets and palettes. The tile and block benchmarks use the
+// first room's.
+Scene MakeRomScene(const Settings& settings, const Rom& rom, const RomTables& tables)
+{
+	Scene scene;
+	scene.source = "rom";
+	std::map<uint32_t, std::shared_ptr<const Tileset>> tilesets;
+	std::map<std::pair<uint32_t, uint32_t>, std::shared_ptr<const std::vector<BigTile>>> blocksets;
+	const size_t count = (settings.rooms != 0) ? std::min(settings.rooms, tables.rooms.size()) : tables.rooms.size();
+	for (size_t i = 0; i < count; ++i)
+	{
+		const size_t index = i * tables.rooms.size() / count;
+		const RomTables::RoomData& rd = tables.rooms[index];
+		if ((rd.tileset >= tables.tilesetOffsets.size()) || (rd.bigTilesetIdx >= tables.bigTileOffsets.size()) ||
+		    tables.bigTileOffsets[rd.bigTilesetIdx].empty())
+		{
+			continue;
+		}
+		auto& tileset = tilesets[tables.tilesetOffsets[rd.tileset]];
+		if (!tileset)
+		{
+			tileset = AssetCache::DecodeTileset(rom, tables.tilesetOffsets[rd.tileset]);
+		}
+		const std::vector<uint32_t>& offsets = tables.bigTileOffsets[rd.bigTilesetIdx];
+		const size_t part = 1 + rd.secBigTileset;
+		const std::pair<uint32_t, uint32_t> key(offsets[0], (part < offsets.size()) ? offsets[part] : 0);
+		auto& blockset = blocksets[key];
+		if (!blockset)
+		{
+			blockset = AssetCache::DecodeBlockset(rom, key.first, key.second);
+		}
+		auto map = std::make_shared<RoomTilemap>(*AssetCache::DecodeRoomMap(rom, rd.offset));
+		for (auto* layer : { &map->background, &map->foreground })
+		{
+			layer->SetTileset(tileset);
+			layer->SetBlockset(blockset);
+		}
+		std::vector<Palette> pals(4);
+		if (rd.roomPalette < tables.roomPalettes.size())
+		{
+			pals[0] = tables.roomPalettes[rd.roomPalette];
+		}
+		if (!scene.tileset)
+		{
+			scene.tileset = tileset;
+			scene.blockset = blockset;
+			scene.pals = pals;
+		}
+		AddRoom(scene, index, map, pals);
+	}
+	if (scene.rooms.empty() || scene.blockset->empty())
+	{
+		throw std::runtime_error("No rooms to render in " + settings.rom_path);
+	}
+	return scene;
+}
+
+void DrawLayers(const Room& room, ImageBuffer& buffer)
+{
+	room.map->background.Draw(buffer);
+	room.map->foreground.Draw(buffer);
+}
+
+// The same steps as exporting a room with its heightmap, short of writing
+// the PNG: each layer is drawn and converted separately, then blended
+const std::vector<uint8_t>& RenderRoom(const Room& room, RoomRenderCache& layers)
+{
+	std::array<RoomRenderCache::LayerOpacity, RoomRenderCache::LAYER_COUNT> opacity;
+	layers.Begin(static_cast<uint16_t>(room.index), 0, room.width, room.height);
+	ImageBuffer buffer(room.width, room.height);
+	room.map->background.Draw(buffer);
+	layers.SetLayer(RoomRenderCache::LAYER_BACKGROUND, buffer, room.pals);
+	buffer.Clear();
+	room.map->foreground.Draw(buffer);
+	layers.SetLayer(RoomRenderCache::LAYER_FOREGROUND, buffer, room.pals);
+	std::vector<uint8_t> hm_rgba;
+	HeightmapOverlay overlay;
+	overlay.Draw(*room.map, hm_rgba);
+	layers.SetLayer(RoomRenderCache::LAYER_HEIGHTMAP, hm_rgba);
+	opacity[RoomRenderCache::LAYER_BACKGROUND] = RoomRenderCache::LayerOpacity{ 0xFF, 0xFF };
+	opacity[RoomRenderCache::LAYER_FOREGROUND] = RoomRenderCache::LayerOpacity{ 0xFF, 0xFF };
+	opacity[RoomRenderCache::LAYER_HEIGHTMAP] = RoomRenderCache::LayerOpacity{ 0x80, 0x80 };
+	return layers.Composite(opacity);
+}
+
+struct ScalingResult
+{
+	size_t threads;
+	size_t renders;
+	double seconds;
+	double mpixels_per_s;
+	double rooms_per_s;
+	// Per-room latencies in milliseconds
+	double p50;
+	double p90;
+	double p99;
+	double max;
+};
+
+class RenderBenchmarks
+{
+public:
+	RenderBenchmarks(const Settings& settings, const Scene& scene)
+		: m_settings(settings), m_scene(scene), m_runner(settings.min_batch_seconds, settings.batches)
+	{
+		std::ostringstream ss;
+		ss << scene.source << " x" << scene.rooms.size() << " rooms";
+		m_rooms_label = ss.str();
+	}
+
+	void RunTiles()
+	{
+		std::mt19937 rng(m_settings.seed);
+		const Tileset& tileset = *m_scene.tileset;
+		const std::vector<BigTile>& blockset = *m_scene.blockset;
+		std::vector<Tile> tiles;
+		std::vector<size_t> blocks;
+		for (size_t i = 0; i < TILE_COUNT; ++i)
+		{
+			Tile tile = RandomTile(rng);
+			tile.SetIndex(static_cast<uint16_t>(tile.GetIndex() % tileset.size()));
+			tiles.push_back(tile);
+			blocks.push_back(Random(rng, static_cast<uint32_t>(blockset.size() - 1)));
+		}
+		const std::string label = m_scene.source + " tileset";
+
+		Run("Tileset::getTile", label, BenchmarkRunner::Work{ tiles.size(), 0, tiles.size() * 64 }, [&]()
+		{
+			size_t total = 0;
+			for (const Tile& tile : tiles)
+			{
+				total += tileset.getTile(tile)[0];
+			}
+			return total;
+		});
+
+		ImageBuffer buffer(BUFFER_SIZE, BUFFER_SIZE);
+		const size_t tiles_across = BUFFER_SIZE / 8;
+		Run("ImageBuffer::InsertTile", label, BenchmarkRunner::Work{ tiles_across * tiles_across, 0, BUFFER_SIZE * BUFFER_SIZE }, [&]()
+		{
+			for (size_t i = 0; i < tiles_across * tiles_across; ++i)
+			{
+				buffer.InsertTile((i % tiles_across) * 8, (i / tiles_across) * 8, i & 3, tiles[i % tiles.size()], tileset);
+			}
+			return buffer.GetWidth();
+		});
+
+		const size_t blocks_across = BUFFER_SIZE / 16;
+		Run("ImageBuffer::InsertBlock", label, BenchmarkRunner::Work{ blocks_across * blocks_across, 0, BUFFER_SIZE * BUFFER_SIZE }, [&]()
+		{
+			for (size_t i = 0; i < blocks_across * blocks_across; ++i)
+			{
+				buffer.InsertBlock((i % blocks_across) * 16, (i / blocks_across) * 16, i & 3, blockset[blocks[i % blocks.size()]], tileset);
+			}
+			return buffer.GetWidth();
+		});
+
+		Tilemap2D tilemap(tiles_across, tiles_across, 0, 0, 0);
+		tilemap.SetTileset(m_scene.tileset);
+		for (size_t i = 0; i < tiles_across * tiles_across; ++i)
+		{
+			tilemap.SetTile({ i % tiles_across, i / tiles_across }, tiles[i % tiles.size()]);
+		}
+		const size_t tilemap_pixels = tilemap.GetBitmapWidth() * tilemap.GetBitmapHeight();
+		Run("Tilemap2D::Draw", label, BenchmarkRunner::Work{ 1, 0, tilemap_pixels }, [&]()
+		{
+			tilemap.Draw(buffer);
+			return buffer.GetWidth();
+		});
+
+		Blockmap2D blockmap(blocks_across, blocks_across, 0, 0, 0);
+		blockmap.SetTileset(m_scene.tileset);
+		blockmap.SetBlockset(m_scene.blockset);
+		for (size_t i = 0; i < blocks_across * blocks_across; ++i)
+		{
+			blockmap.SetTileValue({ i % blocks_across, i / blocks_across }, static_cast<uint16_t>(blocks[i % blocks.size()]));
+		}
+		const size_t blockmap_pixels = blockmap.GetBitmapWidth() * blockmap.GetBitmapHeight();
+		Run("Blockmap2D::Draw", label, BenchmarkRunner::Work{ 1, 0, blockmap_pixels }, [&]()
+		{
+			blockmap.Draw(buffer);
+			return buffer.GetWidth();
+		});
+	}
+
+	// Frames are drawn all over the buffer, partly off every edge, with
+	// every combination of flips
+	void RunSprites()
+	{
+		std::mt19937 rng(m_settings.seed);
+		std::vector<Palette> pals(4);
+		for (uint8_t i = 0; i < 16; ++i)
+		{
+			pals[1].set(i, static_cast<uint8_t>(i * 16), static_cast<uint8_t>(0xFF - i * 16), static_cast<uint8_t>(i * 5));
+		}
+		std::vector<SpriteFrame> frames;
+		size_t sprite_pixels = 0;
+		for (size_t i = 0; i < SPRITE_FRAMES; ++i)
+		{
+			frames.push_back(MakeSpriteFrame(rng));
+			CheckSpriteFlips(frames.back(), pals);
+			sprite_pixels += frames.back().m_sprite_gfx.size() * 64;
+		}
+		std::ostringstream ss;
+		ss << "synthetic sprite frames x" << frames.size();
+
+		ImageBuffer buffer(BUFFER_SIZE, BUFFER_SIZE);
+		const int step = 48;
+		const int across = static_cast<int>(BUFFER_SIZE) / step + 2;
+		const size_t draws = across * across;
+		Run("ImageBuffer::InsertSprite", ss.str(), BenchmarkRunner::Work{ draws, 0, draws * sprite_pixels / frames.size() }, [&]()
+		{
+			for (size_t i = 0; i < draws; ++i)
+			{
+				const int x = static_cast<int>(i % across) * step - step / 2;
+				const int y = static_cast<int>(i / across) * step - step / 2;
+				buffer.InsertSprite(x, y, 1, frames[i % frames.size()], (i & 1) != 0, (i & 2) != 0);
+			}
+			return buffer.GetWidth();
+		});
+	}
+
+	// Each call processes every room once; one operation is one room
+	void RunRooms()
+	{
+		const std::vector<Room>& rooms = m_scene.rooms;
+		const BenchmarkRunner::Work work{ rooms.size(), 0, m_scene.room_pixels };
+		std::vector<ImageBuffer> buffers;
+		for (const Room& room : rooms)
+		{
+			buffers.push_back(ImageBuffer(room.width, room.height));
+			DrawLayers(room, buffers.back());
+		}
+
+		Run("Room layers draw", m_rooms_label, work, [&]()
+		{
+			for (size_t i = 0; i < rooms.size(); ++i)
+			{
+				buffers[i].Clear();
+				DrawLayers(rooms[i], buffers[i]);
+			}
+			return buffers.size();
+		});
+
+		Run("ImageBuffer::GetRGB", m_rooms_label, work, [&]()
+		{
+			size_t total = 0;
+			for (size_t i = 0; i < rooms.size(); ++i)
+			{
+				total += buffers[i].GetRGB(rooms[i].pals).size();
+			}
+			return total;
+		});
+
+		Run("ImageBuffer::GetAlpha", m_rooms_label, work, [&]()
+		{
+			size_t total = 0;
+			for (size_t i = 0; i < rooms.size(); ++i)
+			{
+				total += buffers[i].GetAlpha(rooms[i].pals, 0x80, 0xFF).size();
+			}
+			return total;
+		});
+
+		// Converting a paletted layer to RGB, alpha and priority planes
+		std::vector<RoomRenderCache> caches(rooms.size());
+		for (size_t i = 0; i < rooms.size(); ++i)
+		{
+			RenderRoom(rooms[i], caches[i]);
+		}
+		Run("RoomRenderCache::SetLayer", m_rooms_label, work, [&]()
+		{
+			for (size_t i = 0; i < rooms.size(); ++i)
+			{
+				caches[i].SetLayer(RoomRenderCache::LAYER_BACKGROUND, buffers[i], rooms[i].pals);
+			}
+			return caches.size();
+		});
+
+		Run("HeightmapOverlay::Draw", m_rooms_label, work, [&]()
+		{
+			std::vector<uint8_t> rgba;
+			HeightmapOverlay overlay;
+			size_t total = 0;
+			for (const Room& room : rooms)
+			{
+				overlay.Draw(*room.map, rgba);
+				total += rgba.size();
+			}
+			return total;
+		});
+
+		std::array<RoomRenderCache::LayerOpacity, RoomRenderCache::LAYER_COUNT> opacity;
+		opacity.fill(RoomRenderCache::LayerOpacity{ 0xC0, 0xFF });
+		Run("RoomRenderCache::Composite", m_rooms_label, work, [&]()
+		{
+			size_t total = 0;
+			for (auto& cache : caches)
+			{
+				total += cache.Composite(opacity).size();
+			}
+			return total;
+		});
+
+		Run("Room composite", m_rooms_label, work, [&]()
+		{
+			RoomRenderCache layers;
+			size_t total = 0;
+			for (const Room& room : rooms)
+			{
+				total += RenderRoom(room, layers).size();
+			}
+			return total;
+		});
+
+		const std::string& path = m_settings.scratch_path;
+		Run("ImageBuffer::WritePNG", m_rooms_label + " paletted", work, [&]()
+		{
+			size_t total = 0;
+			for (size_t i = 0; i < rooms.size(); ++i)
+			{
+				total += WritePNG(buffers[i].WritePNG(path, rooms[i].pals));
+			}
+			return total;
+		});
+
+		Run("ImageBuffer::WritePNG", m_rooms_label + " RGB", work, [&]()
+		{
+			size_t total = 0;
+			for (size_t i = 0; i < rooms.size(); ++i)
+			{
+				total += WritePNG(ImageBuffer::WritePNG(path, caches[i].Composite(opacity), rooms[i].width, rooms[i].height));
+			}
+			return total;
+		});
+		std::remove(path.c_str());
+	}
+
+	// Renders every room the given number of rounds on a pool of each size,
+	// timing each room from when a worker picks it up
+	void RunScaling()
+	{
+		if (std::string("Room scaling").find(m_settings.filter) == std::string::npos)
+		{
+			return;
+		}
+		const std::vector<Room>& rooms = m_scene.rooms;
+		const std::vector<size_t> threads = m_settings.threads.empty() ? GetDefaultThreads() : m_settings.threads;
+		for (size_t count : threads)
+		{
+			ThreadPool pool(count);
+			std::vector<double> latencies(rooms.size() * m_settings.rounds);
+			auto render = [&](size_t i)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				RoomRenderCache layers;
+				RenderRoom(rooms[i % rooms.size()], layers);
+				const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+				latencies[i] = elapsed.count();
+			};
+			// One untimed round so every worker has faulted in its buffers
+			pool.ParallelFor(rooms.size(), render);
+			const auto start = std::chrono::steady_clock::now();
+			pool.ParallelFor(latencies.size(), render);
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			std::sort(latencies.begin(), latencies.end());
+
+			ScalingResult result;
+			result.threads = pool.GetWorkerCount();
+			result.renders = latencies.size();
+			result.seconds = elapsed.count();
+			result.mpixels_per_s = m_scene.room_pixels * m_settings.rounds / 1.0e6 / result.seconds;
+			result.rooms_per_s = result.renders / result.seconds;
+			result.p50 = BenchmarkRunner::Percentile(latencies, 50.0);
+			result.p90 = BenchmarkRunner::Percentile(latencies, 90.0);
+			result.p99 = BenchmarkRunner::Percentile(latencies, 99.0);
+			result.max = latencies.back();
+			m_scaling.push_back(result);
+			std::cout << "Room scaling " << std::setw(4) << result.threads << " threads" << std::fixed << std::setprecision(1)
+			          << std::setw(10) << result.mpixels_per_s << " Mpixels/s" << std::setw(10) << result.rooms_per_s << " rooms/s"
+			          << std::setprecision(2) << "  p50 " << result.p50 << " ms  p90 " << result.p90 << " ms  p99 "
+			          << result.p99 << " ms  max " << result.max << " ms" << std::endl;
+		}
+	}
+
+	nlohmann::json ToJson() const
+	{
+		nlohmann::json doc = m_runner.ToJson();
+		nlohmann::json scaling = nlohmann::json::array();
+		for (const auto& result : m_scaling)
+		{
+			scaling.push_back({ { "threads", result.threads },
+			                    { "renders", result.renders },
+			                    { "seconds", result.seconds },
+			                    { "mpixels_per_s", result.mpixels_per_s },
+			                    { "rooms_per_s", result.rooms_per_s },
+			                    { "latency_ms", { { "p50", result.p50 }, { "p90", result.p90 }, { "p99", result.p99 }, { "max", result.max } } } });
+		}
+		doc["benchmark"] = "render";
+		doc["seed"] = m_settings.seed;
+		doc["rom"] = m_settings.rom_path.empty() ? nlohmann::json() : nlohmann::json(m_settings.rom_path);
+		doc["rooms"] = m_scene.rooms.size();
+		doc["room_pixels"] = m_scene.room_pixels;
+		doc["scaling"] = scaling;
+		return doc;
+	}
+private:
+	template <class Op>
+	void Run(const std::string& name, const std::string& input, const BenchmarkRunner::Work& work, Op op)
+	{
+		if (name.find(m_settings.filter) == std::string::npos)
+		{
+			return;
+		}
+		const BenchmarkRunner::Result result = m_runner.Run(name, input, work, op);
+		std::cout << std::left << std::setw(28) << result.name << std::setw(32) << result.input << std::right
+		          << std::fixed << std::setprecision(1) << std::setw(14) << result.ns_per_op << " ns/op"
+		          << std::setw(10) << result.GetMegapixelsPerSecond() << " Mpixels/s" << std::endl;
+	}
+
+	size_t WritePNG(bool written) const
+	{
+		if (!written)
+		{
+			throw std::runtime_error("Unable to write " + m_settings.scratch_path);
+		}
+		return 1;
+	}
+
+	const Settings& m_settings;
+	const Scene& m_scene;
+	BenchmarkRunner m_runner;
+	std::string m_rooms_label;
+	std::vector<ScalingResult> m_scaling;
+};
+}
+
+int main(int argc, char** argv)
+{
+	Settings settings;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool has_value = (i + 1 < argc);
+		unsigned long value = 0;
+		if ((arg == "-h") || (arg == "--help"))
+		{
+			PrintUsage(argv[0]);
+			return 0;
+		}
+		else if ((arg == "--rom") && has_value)
+		{
+			settings.rom_path = argv[++i];
+		}
+		else if ((arg == "--rooms") && has_value)
+		{
+			if (!ParseNumber(argv[++i], 0xFFFF, value))
+			{
+				std::cerr << "Invalid room count \"" << argv[i] << "\"\n";
+				return 1;
+			}
+			settings.rooms = value;
+		}
+		else if ((arg == "--threads") && has_value)
+		{
+			if (!ParseThreads(argv[++i], settings.threads))
+			{
+				std::cerr << "Invalid thread list \"" << argv[i] << "\"\n";
+				return 1;
+			}
+		}
+		else if ((arg == "--rounds") && has_value)
+		{
+			if (!ParseNumber(argv[++i], 10000, value) || (value == 0))
+			{
+				std::cerr << "Invalid round count \"" << argv[i] << "\"\n";
+				return 1;
+			}
+			settings.rounds = value;
+		}
+		else if ((arg == "--json") && has_value)
+		{
+			settings.json_path = argv[++i];
+		}
+		else if ((arg == "--filter") && has_value)
+		{
+			settings.filter = argv[++i];
+		}
+		else if ((arg == "--min-time") && has_value)
+		{
+			char* end = nullptr;
+			settings.min_batch_seconds = std::strtod(argv[++i], &end);
+			if ((*end != '\0') || !(settings.min_batch_seconds > 0.0))
+			{
+				std::cerr << "Invalid minimum time \"" << argv[i] << "\"\n";
+				return 1;
+			}
+		}
+		else if ((arg == "--batches") && has_value)
+		{
+			if (!ParseNumber(argv[++i], 1000, value) || (value == 0))
+			{
+				std::cerr << "Invalid batch count \"" << argv[i] << "\"\n";
+				return 1;
+			}
+			settings.batches = value;
+		}
+		else if ((arg == "--seed") && has_value)
+		{
+			if (!ParseNumber(argv[++i], 0xFFFFFFFF, value))
+			{
+				std::cerr << "Invalid seed \"" << argv[i] << "\"\n";
+				return 1;
+			}
+			settings.seed = static_cast<unsigned>(value);
+		}
+		else if ((arg == "--scratch") && has_value)
+		{
+			settings.scratch_path = argv[++i];
+		}
+		else
+		{
+			std::cerr << "Unknown option \"" << arg << "\"\n";
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	try
+	{
+		Scene scene;
+		if (settings.rom_path.empty())
+		{
+			scene = MakeSyntheticScene(settings);
+		}
+		else
+		{
+			const Rom rom(settings.rom_path);
+			RomTables tables;
+			tables.Load(rom);
+			scene = MakeRomScene(settings, rom, tables);
+		}
+		RenderBenchmarks benchmarks(settings, scene);
+		benchmarks.RunTiles();
+		benchmarks.RunSprites();
+		benchmarks.RunRooms();
+		benchmarks.RunScaling();
+		if (!settings.json_path.empty())
+		{
+			std::ofstream outfile(settings.json_path, std::ios::out | std::ios::trunc);
+			if (!outfile.is_open() || !(outfile << benchmarks.ToJson().dump(1, '\t') << std::endl))
+			{
+				std::cerr << "Unable to write \"" << settings.json_path << "\"\n";
+				return 1;
+			}
+		}
+		return 0;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << "\n";
+		return 1;
+	}
+}